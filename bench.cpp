@@ -0,0 +1,477 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "walk_map.h"
+#include "dungeon.h"
+#include "platformer.h"
+#include "flow_field.h"
+#include "lighting.h"
+
+using namespace std;
+
+// Micro-benchmarks for the hot paths of walk.cpp, mapa2.cpp and
+// mapa_movimiento.cpp over a range of map sizes. Inputs come from fixed
+// seeds, every benchmark is warmed up and then timed in several samples, and
+// the results are printed as JSON on stdout.
+//
+//   g++ -O2 -std=c++17 -pthread bench.cpp -o bench
+//   ./bench > bench_output.txt
+//   ./bench walk/          only the benchmarks whose name starts with walk/
+
+const int SAMPLES = 15;               // timed samples per benchmark
+const double SAMPLE_NS = 2e6;         // minimum duration of a sample
+const unsigned SEED = 12345;          // seed of every generated input
+
+// results of one benchmark, times are per iteration
+struct Result
+{
+    string name;
+    int width, height;
+    long iterations; // per sample
+    double minNs, medianNs, meanNs, stddevNs;
+};
+
+vector<Result> results;
+string filter;
+
+// keeps the optimizer from dropping the benchmarked work
+volatile long sink;
+
+// stream buffer that throws everything away, stands in for the terminal
+class NullBuffer : public streambuf
+{
+    protected:
+        int overflow(int c) override { return c; }
+        streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+NullBuffer nullBuffer;
+ostream nullSink(&nullBuffer);
+
+template <class Fn>
+double timeIterations(Fn& fn, long iterations)
+{
+    auto start = chrono::steady_clock::now();
+    long total = 0;
+    for (long i = 0; i < iterations; i++) total += fn();
+    auto end = chrono::steady_clock::now();
+    sink = sink + total;
+    return chrono::duration<double, nano>(end - start).count();
+}
+
+// fn() does one iteration and returns any value that depends on the work
+template <class Fn>
+void bench(const string& name, int width, int height, Fn fn)
+{
+    if (name.compare(0, filter.size(), filter) != 0) return;
+
+    // warm-up, doubling the iterations until one sample is long enough
+    long iterations = 1;
+    while (timeIterations(fn, iterations) < SAMPLE_NS && iterations < (1L << 26)) iterations *= 2;
+
+    vector<double> times;
+    for (int s = 0; s < SAMPLES; s++) times.push_back(timeIterations(fn, iterations) / iterations);
+    sort(times.begin(), times.end());
+
+    Result result;
+    result.name = name;
+    result.width = width;
+    result.height = height;
+    result.iterations = iterations;
+    result.minNs = times.front();
+    result.medianNs = times[SAMPLES / 2];
+    result.meanNs = 0;
+    for (double t : times) result.meanNs += t;
+    result.meanNs /= SAMPLES;
+    result.stddevNs = 0;
+    for (double t : times) result.stddevNs += (t - result.meanNs) * (t - result.meanNs);
+    result.stddevNs = sqrt(result.stddevNs / SAMPLES);
+    results.push_back(result);
+
+    cerr << name << " " << width << "x" << height << ": " << result.medianNs << " ns" << endl;
+}
+
+// walls on the border and scattered inside, the center is always free
+vector<string> randomRows(int width, int height, double wallChance, char floor)
+{
+    mt19937 random(SEED);
+    uniform_real_distribution<double> chance(0.0, 1.0);
+    vector<string> rows(height, string(width, floor));
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            if (x == 0 || y == 0 || x == width - 1 || y == height - 1 || chance(random) < wallChance) rows[y][x] = '#';
+        }
+    }
+    rows[height / 2][width / 2] = floor;
+    return rows;
+}
+
+void benchWalk()
+{
+    const int sizes[][2] = { {30, 20}, {64, 48}, {128, 96}, {256, 192} };
+    for (const auto& size : sizes)
+    {
+        int width = size[0], height = size[1];
+        walk::Map map(randomRows(width, height, 0.15, '.'));
+        walk::Player player(width / 2, height / 2);
+
+        bench("walk/calculateVisibility", width, height, [&]()
+        {
+            player.rotate(7.0);
+            map.calculateVisibility(player);
+            return (long)player.angle;
+        });
+
+        // one cell forward and back again, every call is a new viewpoint
+        double direction = 1.0;
+        bench("walk/calculateVisibility/step", width, height, [&]()
+        {
+            player.move(direction, map);
+            direction = -direction;
+            map.calculateVisibility(player);
+            return (long)player.x;
+        });
+
+        // a wall next to the player appears and disappears
+        bool wall = false;
+        bench("walk/setCell", width, height, [&]()
+        {
+            wall = !wall;
+            map.setCell((int)player.x + 3, (int)player.y + 1, wall ? '#' : '.');
+            map.calculateVisibility(player);
+            return (long)wall;
+        });
+
+        mt19937 random(SEED);
+        vector<int> targets;
+        for (int i = 0; i < 1024; i++) targets.push_back((int)(random() % (width * height)));
+        size_t next = 0;
+        bench("walk/hasLineOfSight", width, height, [&]()
+        {
+            int target = targets[next++ % targets.size()];
+            return (long)map.hasLineOfSight(player.x, player.y, target % width, target / width);
+        });
+
+        string frame;
+        bench("walk/displayMap", width, height, [&]()
+        {
+            player.rotate(7.0);
+            map.displayMap(player, frame);
+            nullSink << frame << flush;
+            return (long)frame.size();
+        });
+
+        bench("walk/displayFirstPerson", width, height, [&]()
+        {
+            player.rotate(7.0);
+            map.displayFirstPerson(player, frame, 240, 70);
+            nullSink << frame << flush;
+            return (long)frame.size();
+        });
+    }
+}
+
+void benchDungeon()
+{
+    const int sizes[][2] = { {50, 30}, {100, 60}, {200, 120}, {400, 240} };
+    for (const auto& size : sizes)
+    {
+        int width = size[0], height = size[1];
+
+        unsigned seed = SEED;
+        bench("mapa2/generate", width, height, [&]()
+        {
+            srand(seed++);
+            dungeon::Map map(width, height);
+            map.generate();
+            return 1L;
+        });
+
+        srand(SEED);
+        dungeon::Map map(width, height);
+        map.generate();
+
+        mt19937 random(SEED);
+        vector<dungeon::Room> candidates;
+        for (int i = 0; i < 1024; i++)
+        {
+            int w = dungeon::Min_Rooms_Size + random() % (dungeon::Max_Rooms_Size - dungeon::Min_Rooms_Size + 1);
+            int h = dungeon::Min_Rooms_Size + random() % (dungeon::Max_Rooms_Size - dungeon::Min_Rooms_Size + 1);
+            candidates.push_back(dungeon::Room(1 + random() % (width - w - 2), 1 + random() % (height - h - 2), w, h));
+        }
+        size_t next = 0;
+        bench("mapa2/canplaceRoom", width, height, [&]()
+        {
+            return (long)map.canplaceRoom(candidates[next++ % candidates.size()]);
+        });
+
+        bench("mapa2/placeDoors", width, height, [&]()
+        {
+            map.placeDoors();
+            return 1L;
+        });
+    }
+}
+
+// cave mode of mapa2, up to the 4096x4096 maps it is meant for
+void benchCaves()
+{
+    const int sizes[][2] = { {50, 30}, {400, 240}, {1024, 1024}, {4096, 4096} };
+    for (const auto& size : sizes)
+    {
+        int width = size[0], height = size[1];
+
+        unsigned seed = SEED;
+        dungeon::Map map(width, height);
+        bench("mapa2/generateCaves", width, height, [&]()
+        {
+            srand(seed++);
+            map.generateCaves();
+            return 1L;
+        });
+
+        CaveBoard board(width, height);
+        board.randomize(45, SEED);
+        bench("caves/step", width, height, [&]()
+        {
+            board.step();
+            return 1L;
+        });
+    }
+}
+
+// every room center of a generated dungeon as goal, then one goal walking
+void benchFlowField()
+{
+    const int sizes[][2] = { {50, 30}, {200, 120}, {400, 240} };
+    for (const auto& size : sizes)
+    {
+        int width = size[0], height = size[1];
+        srand(SEED);
+        dungeon::Map map(width, height);
+        map.generate();
+        auto cost = [&](int x, int y) { return map.getCell(x, y) == dungeon::Wall ? 0 : 1; };
+        FlowField field(width, height, cost);
+
+        vector<FlowPoint> goals;
+        for (const dungeon::Room& room : map.getRooms()) goals.push_back(FlowPoint(room.centerX(), room.centerY()));
+
+        bench("flowfield/compute", width, height, [&]()
+        {
+            field.compute(goals);
+            return (long)field.distance(1, 1);
+        });
+
+        bench("flowfield/compute4", width, height, [&]()
+        {
+            field.compute(goals, 4);
+            return (long)field.distance(1, 1);
+        });
+
+        // the goal walks back and forth inside the first room
+        const dungeon::Room& room = map.getRooms().front();
+        FlowPoint goal(room.x, room.centerY());
+        field.compute(vector<FlowPoint>(1, goal));
+        int step = 1;
+        bench("flowfield/moveGoal", width, height, [&]()
+        {
+            if (goal.x + step < room.x || goal.x + step >= room.x + room.width) step = -step;
+            FlowPoint next(goal.x + step, goal.y);
+            field.moveGoal(goal, next);
+            goal = next;
+            return (long)field.distance(1, 1);
+        });
+
+        // the corridor cell next to the first room's door opens and closes
+        field.compute(goals);
+        FlowPoint door(-1, -1);
+        for (int y = 0; y < height && door.x < 0; y++)
+            for (int x = 0; x < width && door.x < 0; x++)
+                if (map.getCell(x, y) == dungeon::Door) door = FlowPoint(x, y);
+        bool blocked = false;
+        bench("flowfield/updateCosts", width, height, [&]()
+        {
+            blocked = !blocked;
+            field.updateCosts(CellRect(door.x, door.y, door.x + 1, door.y + 1),
+                              [&](int x, int y) { return blocked ? 0 : cost(x, y); });
+            return (long)field.distance(1, 1);
+        });
+
+        // one lookup per agent on every floor cell
+        bench("flowfield/nextStep", width, height, [&]()
+        {
+            long moves = 0;
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    int dx, dy;
+                    if (field.nextStep(x, y, dx, dy)) moves += dx + 2 * dy;
+                }
+            }
+            return moves;
+        });
+    }
+}
+
+// torches on a generated dungeon, one of them walking around
+void benchLighting()
+{
+    const int sizes[][2] = { {100, 60}, {400, 240} };
+    const int counts[] = { 64, 512 };
+    for (const auto& size : sizes)
+    {
+        int width = size[0], height = size[1];
+        srand(SEED);
+        dungeon::Map map(width, height);
+        map.generate();
+
+        for (int count : counts)
+        {
+            mt19937 random(SEED);
+            LightMap lights(width, height, [&](int x, int y) { return map.getCell(x, y) == dungeon::Wall; });
+            for (int i = 0; i < count; i++)
+                lights.addLight(Light(random() % width, random() % height, 3 + random() % 8, 120 + random() % 100));
+            lights.update();
+
+            bench("lighting/rebuild/" + to_string(count), width, height, [&]()
+            {
+                lights.rebuild();
+                return (long)lights.level(width / 2, height / 2);
+            });
+
+            long step = 0;
+            bench("lighting/moveLight/" + to_string(count), width, height, [&]()
+            {
+                // one light walks back and forth, everything else stays
+                int dx = (step++ / 8) % 2 == 0 ? 1 : -1;
+                const Light& l = lights.getLight(0);
+                lights.moveLight(0, l.x + dx, l.y);
+                lights.update();
+                return (long)lights.level(l.x, l.y);
+            });
+
+            bench("lighting/setOpaque/" + to_string(count), width, height, [&]()
+            {
+                // a wall appears and disappears next to a light
+                const Light& l = lights.getLight(1);
+                bool wall = map.getCell(l.x + 1, l.y) == dungeon::Wall;
+                lights.setOpaque(l.x + 1, l.y, (step++ % 2 == 0) != wall);
+                lights.update();
+                return (long)lights.level(l.x, l.y);
+            });
+        }
+    }
+}
+
+// platforms at random heights along a long level
+vector<string> platformRows(int width, int height)
+{
+    mt19937 random(SEED);
+    vector<string> rows(height, string(width, ' '));
+    for (int x = 0; x < width; x++) rows[0][x] = rows[height - 1][x] = '#';
+    for (int y = 0; y < height; y++) rows[y][0] = rows[y][width - 1] = '#';
+    for (int x = 12; x + 8 < width; x += 6 + random() % 10)
+    {
+        int y = 4 + random() % (height - 8);
+        int length = 3 + random() % 6;
+        for (int i = 0; i < length; i++) rows[y][x + i] = '#';
+    }
+    rows[height - 2][10] = '@';
+    return rows;
+}
+
+void benchPlatformer()
+{
+    const int widths[] = { 70, 1000, 10000, 100000 };
+    for (int width : widths)
+    {
+        int height = platformer::Height;
+        platformer::Level level(platformRows(width, height));
+
+        long frame = 0;
+        bench("mapa_movimiento/Gravity", width, height, [&]()
+        {
+            // hold the jump key 10 frames, release it 10 frames
+            level.Jump((frame++ / 10) % 2 == 0);
+            level.Gravity();
+            return (long)level.playerY();
+        });
+
+        bench("mapa_movimiento/movplayer", width, height, [&]()
+        {
+            // run 200 frames right, 200 frames left
+            level.movplayer((frame++ / 200) % 2 == 0 ? 2 : -2);
+            return (long)level.playerX();
+        });
+
+        vector<string> viewport;
+        bench("mapa_movimiento/drawMap", width, height, [&]()
+        {
+            // scrolling camera
+            level.movplayer((frame++ / 200) % 2 == 0 ? 2 : -2);
+            level.drawMap(viewport);
+            return (long)viewport[0][0];
+        });
+    }
+
+    // physics kernel with many bodies on a 1000 column level
+    typedef JumpProfile<toFixed(0.9), toFixed(-3.5), toFixed(-0.5), 8> Physics;
+    platformer::Level level(platformRows(1000, platformer::Height));
+    const int counts[] = { 256, 4096, 65536 };
+    for (int count : counts)
+    {
+        mt19937 random(SEED);
+        BodyArray bodies;
+        for (int i = 0; i < count; i++) bodies.add(1 + random() % 998, platformer::Height - 2);
+
+        long frame = 0;
+        bench("physics/stepBodies", count, 1, [&]()
+        {
+            for (int i = 0; i < count; i++) bodies.jumpHeld[i] = ((frame + i) / 10) % 2 == 0;
+            frame++;
+            stepBodies<Physics>(bodies, level.height(), [&](int x, int y) { return level.isSolid(x, y); });
+            return (long)bodies.y[count - 1];
+        });
+    }
+}
+
+void printJson()
+{
+    cout << "{\n  \"samples\": " << SAMPLES << ",\n  \"seed\": " << SEED << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "    {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"cells\": %ld, \"iterations\": %ld, "
+                 "\"min_ns\": %.1f, \"median_ns\": %.1f, \"mean_ns\": %.1f, \"stddev_ns\": %.1f}%s\n",
+                 r.name.c_str(), r.width, r.height, (long)r.width * r.height, r.iterations,
+                 r.minNs, r.medianNs, r.meanNs, r.stddevNs, i + 1 < results.size() ? "," : "");
+        cout << line;
+    }
+    cout << "  ]\n}" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) filter = argv[1];
+
+    benchWalk();
+    benchDungeon();
+    benchCaves();
+    benchFlowField();
+    benchLighting();
+    benchPlatformer();
+    printJson();
+
+    return 0;
+}
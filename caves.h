@@ -0,0 +1,284 @@
+#ifndef CAVES_H
+#define CAVES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+// Cellular automaton caves on a bitboard.
+// Every row is packed in 64-bit words (bit set = wall), so one pass of bit
+// operations updates 64 cells: the 3x3 wall count of every cell is added up
+// with bit-sliced adders (one word per bit of the count) instead of counted
+// cell by cell. Rows have an all-wall word on each side and there is an
+// all-wall row above and below the map, so the word loops never test
+// coordinates and the compiler can vectorize them.
+//
+// Generation: randomize(), step() a few times, keepLargestRegion().
+
+// index of the lowest set bit, bits must not be 0
+inline int ctz64(uint64_t bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#elif defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+    for (; !(bits & 1); bits >>= 1) index++;
+    return index;
+#endif
+}
+
+// number of set bits
+inline int popcount64(uint64_t bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(bits);
+#elif defined(__GNUC__)
+    return __builtin_popcountll(bits);
+#else
+    int count = 0;
+    for (; bits; bits &= bits - 1) count++;
+    return count;
+#endif
+}
+
+class CaveBoard
+{
+    private:
+        int w, h;
+        int words;                    // words per row inside the map
+        int stride;                   // words + 2 padding words
+        std::vector<uint64_t> cells;  // (h + 2) rows of stride words
+        std::vector<uint64_t> next;   // step() output, swapped with cells
+
+        uint64_t* row(std::vector<uint64_t>& board, int y) { return &board[(size_t)(y + 1) * stride + 1]; }
+        const uint64_t* row(int y) const { return &cells[(size_t)(y + 1) * stride + 1]; }
+
+        // cells past the width in the last word of a row
+        uint64_t paddingBits() const
+        {
+            return w % 64 == 0 ? 0 : ~0ULL << (w % 64);
+        }
+
+        // walls outside the map and on its border
+        void seal(std::vector<uint64_t>& board)
+        {
+            std::fill(board.begin(), board.begin() + 2 * stride, ~0ULL);
+            std::fill(board.end() - 2 * stride, board.end(), ~0ULL);
+            for (int y = 0; y < h; y++)
+            {
+                uint64_t* r = row(board, y);
+                r[-1] = ~0ULL;
+                r[words] = ~0ULL;
+                r[0] |= 1;
+                r[words - 1] |= paddingBits() | (1ULL << ((w - 1) % 64));
+            }
+        }
+
+        // three horizontal neighbours of every cell of word i added up: s + 2 * c
+        static void sum3(const uint64_t* r, int i, uint64_t& s, uint64_t& c)
+        {
+            uint64_t left = (r[i] << 1) | (r[i - 1] >> 63);
+            uint64_t right = (r[i] >> 1) | (r[i + 1] << 63);
+            s = left ^ r[i] ^ right;
+            c = (left & r[i]) | (right & (left ^ r[i]));
+        }
+
+        // makes cells [x0, x1) of a row walls
+        static void fillWall(uint64_t* r, int x0, int x1)
+        {
+            for (int i = x0 / 64; i <= (x1 - 1) / 64; i++)
+            {
+                int from = std::max(x0 - i * 64, 0), to = std::min(x1 - i * 64, 64);
+                r[i] |= (to == 64 ? ~0ULL : (1ULL << to) - 1) & (~0ULL << from);
+            }
+        }
+
+    public:
+        CaveBoard(int width, int height)
+            : w(width), h(height), words((width + 63) / 64), stride(words + 2),
+              cells((size_t)(height + 2) * stride, ~0ULL), next(cells.size(), ~0ULL) {}
+
+        int width() const { return w; }
+        int height() const { return h; }
+
+        bool wall(int x, int y) const
+        {
+            return (row(y)[x / 64] >> (x % 64)) & 1;
+        }
+
+        // fillPercent of the cells become walls, from a splitmix64 stream
+        void randomize(int fillPercent, uint64_t seed)
+        {
+            // a bit is set with probability threshold / 256: random words are
+            // combined from the lowest bit of the threshold up, OR for a 1, AND for a 0
+            int threshold = std::max(0, std::min(256, (fillPercent * 256 + 50) / 100));
+            for (int y = 0; y < h; y++)
+            {
+                uint64_t* r = row(cells, y);
+                for (int i = 0; i < words; i++)
+                {
+                    uint64_t bits = 0;
+                    for (int b = 0; b < 8; b++)
+                    {
+                        seed += 0x9e3779b97f4a7c15ULL;
+                        uint64_t z = seed;
+                        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                        z ^= z >> 31;
+                        bits = (threshold >> b) & 1 ? bits | z : bits & z;
+                    }
+                    r[i] = threshold == 256 ? ~0ULL : bits;
+                }
+            }
+            seal(cells);
+        }
+
+        // one round of the 4-5 rule: a cell is a wall when 5 or more of the
+        // 9 cells of its 3x3 neighbourhood are walls (a wall stays with 4
+        // walls around it, a floor closes with 5)
+        void step()
+        {
+            for (int y = 0; y < h; y++)
+            {
+                const uint64_t* above = row(cells, y - 1);
+                const uint64_t* center = row(cells, y);
+                const uint64_t* below = row(cells, y + 1);
+                uint64_t* out = row(next, y);
+                for (int i = 0; i < words; i++)
+                {
+                    uint64_t a0, a1, b0, b1, c0, c1;
+                    sum3(above, i, a0, a1);
+                    sum3(center, i, b0, b1);
+                    sum3(below, i, c0, c1);
+                    // count = (a0 + b0 + c0) + 2 * (a1 + b1 + c1) = s + 2 * u + 4 * v
+                    uint64_t s = a0 ^ b0 ^ c0;
+                    uint64_t carry = (a0 & b0) | (c0 & (a0 ^ b0));
+                    uint64_t twos = a1 ^ b1 ^ c1;
+                    uint64_t fours = (a1 & b1) | (c1 & (a1 ^ b1));
+                    uint64_t u = carry ^ twos;
+                    uint64_t v0 = (carry & twos) ^ fours;
+                    uint64_t v1 = carry & twos & fours;
+                    out[i] = v1 | (v0 & (s | u));
+                }
+            }
+            seal(next);
+            cells.swap(next);
+        }
+
+        // fills every open region but the largest one (4-connected), so the
+        // whole cave can be walked; returns its size in cells
+        long keepLargestRegion()
+        {
+            // runs of floor cells, joined with the overlapping runs of the row
+            // above in a union-find (a root's parent is minus its area);
+            // counted first so the array never grows
+            struct Run { int x0, x1, parent; };
+            std::vector<Run> runs;
+            std::vector<int> rowStart(h + 1);
+            auto find = [&](int i)
+            {
+                int root = i;
+                while (runs[root].parent >= 0) root = runs[root].parent;
+                while (runs[i].parent >= 0 && runs[i].parent != root)
+                {
+                    int up = runs[i].parent;
+                    runs[i].parent = root;
+                    i = up;
+                }
+                return root;
+            };
+
+            std::vector<int> changes(w + 1);
+            size_t count = 0;
+            for (int y = 0; y < h; y++)
+            {
+                const uint64_t* r = row(y);
+                for (int i = 0; i < words; i++) count += popcount64(r[i] ^ ((r[i] << 1) | (r[i - 1] >> 63)));
+            }
+            runs.reserve(count / 2);
+
+            for (int y = 0; y < h; y++)
+            {
+                rowStart[y] = (int)runs.size();
+                // every change between wall and floor starts or ends a run; the
+                // border column is wall, so they come in pairs
+                const uint64_t* r = row(y);
+                int n = 0;
+                for (int i = 0; i < words; i++)
+                {
+                    uint64_t bits = r[i] ^ ((r[i] << 1) | (r[i - 1] >> 63));
+                    for (; bits; bits &= bits - 1) changes[n++] = i * 64 + ctz64(bits);
+                }
+                for (int k = 0; k + 1 < n; k += 2) runs.push_back(Run{ changes[k], changes[k + 1], changes[k] - changes[k + 1] });
+
+                if (y == 0) continue;
+                int above = rowStart[y - 1];
+                for (int i = rowStart[y]; i < (int)runs.size() && above < rowStart[y]; )
+                {
+                    if (runs[above].x0 < runs[i].x1 && runs[i].x0 < runs[above].x1)
+                    {
+                        int a = find(above), b = find(i);
+                        if (a > b) std::swap(a, b);
+                        if (a != b)
+                        {
+                            runs[a].parent += runs[b].parent;
+                            runs[b].parent = a;
+                        }
+                    }
+                    // the run ending first can't overlap anything further
+                    if (runs[above].x1 < runs[i].x1) above++;
+                    else i++;
+                }
+            }
+            rowStart[h] = (int)runs.size();
+
+            // roots have the lowest index of their region, so in one pass in
+            // order every run can point straight to its root
+            int largest = -1;
+            for (int i = 0; i < (int)runs.size(); i++)
+            {
+                int parent = runs[i].parent;
+                if (parent >= 0 && runs[parent].parent >= 0) runs[i].parent = runs[parent].parent;
+                else if (parent < 0 && (largest < 0 || parent < runs[largest].parent)) largest = i;
+            }
+
+            for (int y = 0; y < h; y++)
+            {
+                uint64_t* r = row(cells, y);
+                for (int i = rowStart[y]; i < rowStart[y + 1]; i++)
+                {
+                    if (i != largest && runs[i].parent != largest) fillWall(r, runs[i].x0, runs[i].x1);
+                }
+            }
+            return largest < 0 ? 0 : -(long)runs[largest].parent;
+        }
+
+        // writes the board as tiles, 8 cells per lookup;
+        // rowOut(y) returns where the w tiles of row y go
+        template <class RowFn>
+        void toTiles(char wallTile, char floorTile, RowFn rowOut) const
+        {
+            char table[256][8];
+            for (int bits = 0; bits < 256; bits++)
+                for (int b = 0; b < 8; b++) table[bits][b] = (bits >> b) & 1 ? wallTile : floorTile;
+
+            for (int y = 0; y < h; y++)
+            {
+                const uint8_t* bytes = (const uint8_t*)row(y); // little endian: byte k holds cells 8k..8k+7
+                char* out = rowOut(y);
+                int x = 0;
+                for (; x + 8 <= w; x += 8) std::copy(table[bytes[x / 8]], table[bytes[x / 8]] + 8, out + x);
+                for (; x < w; x++) out[x] = wall(x, y) ? wallTile : floorTile;
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef DUNGEON_H
+#define DUNGEON_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include "grid.h"
+#include "caves.h"
+#include "map_changes.h"
+#include "trace.h"
+
+// Room and corridor generator of mapa2.cpp, separate from main so other
+// programs (and the benchmarks) can generate dungeons
+namespace dungeon
+{
+
+//default map dimensions
+const int Width = 50;
+const int Height = 30;
+//room constraints
+const int Min_Rooms = 5;
+const int Max_Rooms = 7;
+//room size constraints
+const int Min_Rooms_Size = 6;
+const int Max_Rooms_Size = 12;
+//tile types
+enum Tile{
+    Wall = '#',
+    Floor = '.',
+    Door = '+',
+    Corridor = ' '
+};
+
+struct Room
+{
+    // coord x, y
+    int x, y;
+    // size
+    int width, height;
+    //builder
+    Room(int _x, int _y, int _w, int _h) : x(_x), y(_y), width(_w), height(_h) {}
+    // returns the coordinate x of the center of the room
+    int centerX() const { return x + width / 2; }
+    // returns the coordinate y of the center of the room
+    int centerY() const { return y + height / 2; }
+    // verifies if this room overlaps with another (margin of 2)
+    bool overlaps(const Room& other, int margin = 2) const
+    {
+        return !(x + width + margin < other.x || 
+                 other.x + other.width + margin < x ||
+                 y + height + margin < other.y || 
+                 other.y + other.height + margin < y);
+    }
+};
+
+
+class Map{
+    private:
+    // map, cells outside it read as Wall
+    Grid<char> map;
+    // array of rooms
+    std::vector<Room> rooms;
+    // cells changed after generation
+    ChangeTracker changes;
+
+    void applyChanges()
+    {
+        for(const CellRect& r : changes.take()) changes.notify(r);
+    }
+
+    public:
+    //builder
+    Map(int width = Width, int height = Height) : map(width, height, Wall, Wall)
+    {
+        initializeMap();
+    }
+    int width() const { return map.width(); }
+    int height() const { return map.height(); }
+    // tile at (x, y), Wall outside the map
+    char getCell(int x, int y) const { return map.get(x, y); }
+    const std::vector<Room>& getRooms() const { return rooms; }
+    // changes a tile after generation (a door opening, a wall breaking);
+    // outside a batch the listeners hear about it right away
+    void setCell(int x, int y, Tile tile)
+    {
+        if(!map.inside(x, y) || map.at(x, y) == tile) return;
+        map.at(x, y) = tile;
+        changes.add(x, y);
+        if(!changes.batching()) applyChanges();
+    }
+    void beginChanges() { changes.begin(); }
+    void endChanges() { if(changes.end()) applyChanges(); }
+    int subscribe(ChangeTracker::Listener listener) { return changes.subscribe(listener); }
+    void unsubscribe(int id) { changes.unsubscribe(id); }
+    // the map as text rows, one character per tile
+    std::vector<std::string> toRows() const
+    {
+        std::vector<std::string> rows;
+        for(int y=0; y<map.height(); y++) rows.push_back(std::string(map.row(y), map.width()));
+        return rows;
+    }
+    // initializes the map
+    void initializeMap(){
+        map.fill(Wall);
+    }
+    // creates a room if it is within the map limits
+    void createRoom(const Room& room)
+    {
+        for(int i=room.y; i<room.y + room.height; i++)
+        {
+            for(int j=room.x; j<room.x + room.width; j++)
+            {
+                map.set(j, i, Floor);
+            }
+        }
+    }
+
+    bool canplaceRoom(const Room& newRoom)
+    {
+        // verify map limits
+        if(newRoom.x <1 || newRoom.y < 1 ||
+           newRoom.x + newRoom.width >= map.width() -1 ||
+           newRoom.y + newRoom.height >= map.height() -1)
+        {
+            return false;
+        }
+        // verify overlapping with other rooms
+        for(const Room& room : rooms)
+        {
+            if(newRoom.overlaps(room))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    // creates a horizontal corridor
+    void createHorizontalCorridor(int x1, int x2, int y)
+    {
+        // calculate the start
+        int startx = std::min(x1,x2);
+        // calculate the end
+        int endx = std::max(x1,x2);
+        // create the corridor (room centers are always inside the map)
+        for(int x = startx; x<= endx; x++)
+        {
+            if(map.at(x, y) == Wall) map.at(x, y) = Corridor;
+        }
+    }
+    // creates a vertical corridor
+    void createVerticalCorridor(int x, int y1, int y2)
+    {
+        // calculate the start
+        int starty = std::min(y1,y2);
+        // calculate the end
+        int endy = std::max(y1,y2);
+        // create the corridor (room centers are always inside the map)
+        for(int y = starty; y<= endy; y++)
+        {
+            if(map.at(x, y) == Wall) map.at(x, y) = Corridor;
+        }
+    }
+    // connects two rooms with a corridor in L shape
+    void connectRooms(const Room& room1, const Room& room2)
+    {
+        // get the center of the rooms to connect
+        int x1 = room1.centerX();
+        // get the center of the rooms to connect
+        int y1 = room1.centerY();
+        // get the center of the rooms to connect
+        int x2 = room2.centerX();
+        // get the center of the rooms to connect
+        int y2 = room2.centerY();
+        // create the L shaped corridor randomly
+        if(rand() % 2 == 0)
+        {
+            createHorizontalCorridor(x1,x2,y1);
+            createVerticalCorridor(x2,y1,y2);
+        }
+        else
+        {
+            createVerticalCorridor(x1,y1,y2);
+            createHorizontalCorridor(x1,x2,y2);
+        }
+    }
+    // door placement, the cells just outside a room are at worst the map
+    // border, which reads as Wall
+    void placeDoors()
+    {
+        // iterate over all generated rooms
+        for(const Room& room : rooms)
+        {
+            // incorridor flag  
+            bool inCorridor = false;
+            // top wall detection
+            for(int x = room.x; x< room.x + room.width; x++)
+            {
+                if(map.at(x, room.y) == Floor &&
+                   map.at(x, room.y -1) == Corridor)
+                {
+                    if(!inCorridor)
+                    {
+                        map.at(x, room.y) = Door;
+                        inCorridor = true;
+                    }
+                    else
+                    {
+                        map.at(x, room.y) = Wall;
+                    }
+                }
+                else
+                {
+                    inCorridor = false;
+                }
+            }
+            // bottom wall
+            inCorridor = false;
+            for(int x = room.x; x< room.x + room.width; x++)
+            {
+                if(map.at(x, room.y + room.height -1) == Floor &&
+                   map.at(x, room.y + room.height) == Corridor)
+                {
+                    if(!inCorridor)
+                    {
+                        map.at(x, room.y + room.height -1) = Door;
+                        inCorridor = true;
+                    }
+                    else
+                    {
+                        map.at(x, room.y + room.height -1) = Wall;
+                    }
+                }
+                else
+                {
+                    inCorridor = false;
+                }
+                // left wall
+                inCorridor = false;
+                for(int y = room.y; y< room.y + room.height; y++)
+                {
+                    if(map.at(room.x, y) == Floor &&
+                       map.at(room.x - 1, y) == Corridor)
+                    {
+                        if(!inCorridor)
+                        {
+                            map.at(room.x, y) = Door;
+                            inCorridor = true;
+                        }
+                        else
+                        {
+                            map.at(room.x, y) = Wall;
+                        }
+                    }
+                    else
+                    {
+                        inCorridor = false;
+                    }
+                }
+                // right wall
+                inCorridor = false;
+                for(int y = room.y; y< room.y + room.height; y++)
+                {
+                    if(map.at(room.x + room.width -1, y) == Floor &&
+                       map.at(room.x + room.width, y) == Corridor)
+                    {
+                        if(!inCorridor)
+                        {
+                            map.at(room.x + room.width -1, y) = Door;
+                            inCorridor = true;
+                        }
+                        else
+                        {
+                            map.at(room.x + room.width -1, y) = Wall;
+                        }
+                    }
+                    else
+                    {
+                        inCorridor = false;
+                    }
+                }
+            }
+        }
+    }
+    // generates the map  
+    void generate()
+    {
+        TRACE_SCOPE("generate");
+        // generate random number of rooms
+        int numRooms = Min_Rooms + rand() % (Max_Rooms - Min_Rooms + 1);
+        // generate non-overlapping rooms
+        int attempts = 0;
+        while(rooms.size() < numRooms && attempts < 1000)
+        {
+            // random width
+            int w = Min_Rooms_Size + rand() % (Max_Rooms_Size - Min_Rooms_Size + 1);
+            // random height
+            int h = Min_Rooms_Size + rand() % (Max_Rooms_Size - Min_Rooms_Size + 1);
+            // random position in x
+            int x = 1 + rand() % (map.width() - w - 2);
+            // random position in y
+            int y = 1 + rand() % (map.height() - h - 2);
+            // create a new room
+            Room newRoom(x, y, w, h);
+            // check if it can be placed
+            {
+                TRACE_SCOPE("place room");
+                if(canplaceRoom(newRoom))
+                {
+                    rooms.push_back(newRoom);
+                    createRoom(newRoom);
+                }
+            }
+            attempts++;
+
+            // connect rooms with corridors
+            {
+                TRACE_SCOPE("connect rooms");
+                for(size_t i=1; i<rooms.size(); i++)
+                {
+                    connectRooms(rooms[i], rooms[i-1]);
+                }
+            }
+
+            {
+                TRACE_SCOPE("place doors");
+                placeDoors();
+            }
+        }
+
+        TRACE_COUNTER("placement attempts", attempts);
+        TRACE_COUNTER("rooms", rooms.size());
+    }
+    // generates organic caves instead of rooms: random walls, rounds of the
+    // 4-5 cellular automaton rule, then only the largest open region is kept
+    void generateCaves(int fillPercent = 45, int rounds = 5)
+    {
+        TRACE_SCOPE("generate caves");
+        rooms.clear();
+        CaveBoard board(map.width(), map.height());
+        board.randomize(fillPercent, ((uint64_t)rand() << 32) ^ (uint64_t)rand());
+        for(int i=0; i<rounds; i++) board.step();
+        board.keepLargestRegion();
+        board.toTiles(Wall, Floor, [&](int y){ return map.row(y); });
+    }
+    // display the map
+    void display()
+    {
+        TRACE_SCOPE("display");
+        for(int y=0; y<map.height(); y++)
+        {
+            std::cout.write(map.row(y), map.width());
+            std::cout << std::endl;
+        }
+
+        std::cout << "  # = Muro\n";
+        std::cout << "  . = Suelo de habitación\n";
+        std::cout << "    = Pasillo\n";
+        std::cout << "  + = Puerta\n";
+    }
+
+};
+
+} // namespace dungeon
+
+#endif
@@ -0,0 +1,520 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "grid.h"
+#include "map_changes.h"
+
+// Flow fields: distance from every cell to the nearest of one or more goals,
+// plus the step that gets closer. Any number of agents chasing the same goals
+// share one field and each agent looks up its move in O(1).
+//
+// Every cell has a cost to enter it (0 = blocked, 1..FLOW_MAX_COST) and moves
+// are 4-connected. Distances come from a bucket-queue Dijkstra (a plain BFS
+// wavefront when all costs are 1). The map is split in square tiles that can
+// be solved on several threads: each pass runs the Dijkstra inside every
+// active tile, then wakes up the neighbours of the tiles whose border changed.
+
+const int FLOW_MAX_COST = 15;
+const int FLOW_TILE = 64;               // tile side for the threaded solver
+const int32_t FLOW_UNREACHABLE = INT32_MAX;
+const int8_t FLOW_NO_DIRECTION = -1;
+
+// moves in direction order, direction(x, y) indexes these
+const int FLOW_DX[4] = { 1, 0, -1, 0 };
+const int FLOW_DY[4] = { 0, 1, 0, -1 };
+
+struct FlowPoint
+{
+    int x, y;
+    FlowPoint(int _x = 0, int _y = 0) : x(_x), y(_y) {}
+};
+
+// Threads of the tiled solver meet here between the phases of a pass. The
+// last one to arrive runs done() before any of them goes on, so done() can
+// prepare the next phase without racing with it.
+class FlowBarrier
+{
+    private:
+        std::mutex lock;
+        std::condition_variable released;
+        int threads;
+        int waiting;
+        unsigned generation;
+
+    public:
+        explicit FlowBarrier(int count) : threads(count), waiting(0), generation(0) {}
+
+        template <class Done>
+        void wait(Done done)
+        {
+            std::unique_lock<std::mutex> hold(lock);
+            unsigned arrived = generation;
+            if (++waiting == threads)
+            {
+                done();
+                waiting = 0;
+                generation++;
+                released.notify_all();
+                return;
+            }
+            released.wait(hold, [&]() { return generation != arrived; });
+        }
+};
+
+class FlowField
+{
+    private:
+        Grid<uint8_t> costs;       // cost to enter each cell, the border is blocked
+        Grid<int32_t> distances;   // stored distance, see offset
+        Grid<int8_t> directions;   // index into FLOW_DX / FLOW_DY
+        int32_t offset;            // added to every stored distance, moveGoal raises it in O(1)
+        std::vector<FlowPoint> goals;
+
+        int tilesX() const { return (costs.width() + FLOW_TILE - 1) / FLOW_TILE; }
+        int tilesY() const { return (costs.height() + FLOW_TILE - 1) / FLOW_TILE; }
+
+        // distance of a cell, FLOW_UNREACHABLE stays as it is
+        int32_t value(int x, int y) const
+        {
+            int32_t d = distances.at(x, y);
+            return d == FLOW_UNREACHABLE ? d : d + offset;
+        }
+
+        void store(int x, int y, int32_t d)
+        {
+            distances.at(x, y) = d - offset;
+        }
+
+        // Dijkstra with a circular bucket queue: every queued distance is
+        // within FLOW_MAX_COST of the current one. Only cells inside
+        // [x0, x1) x [y0, y1) are relaxed; the seeds already hold their
+        // distance and enter the queue when the wavefront reaches it. Cells
+        // whose distance was set are appended to settled if given.
+        void relax(const std::vector<FlowPoint>& seedCells, int x0, int y0, int x1, int y1,
+                   std::vector<FlowPoint>* settled = nullptr)
+        {
+            std::vector<std::pair<int32_t, FlowPoint> > seeds;
+            for (const FlowPoint& p : seedCells) seeds.push_back(std::make_pair(value(p.x, p.y), p));
+            std::sort(seeds.begin(), seeds.end(),
+                      [](const std::pair<int32_t, FlowPoint>& a, const std::pair<int32_t, FlowPoint>& b) { return a.first < b.first; });
+
+            std::vector<FlowPoint> buckets[FLOW_MAX_COST + 1];
+            size_t queued = 0;
+            size_t nextSeed = 0;
+            int32_t current = 0;
+            while (queued > 0 || nextSeed < seeds.size())
+            {
+                if (queued == 0) current = std::max(current, seeds[nextSeed].first);
+                std::vector<FlowPoint>& bucket = buckets[current % (FLOW_MAX_COST + 1)];
+                for (; nextSeed < seeds.size() && seeds[nextSeed].first == current; nextSeed++)
+                {
+                    bucket.push_back(seeds[nextSeed].second);
+                    queued++;
+                }
+
+                for (const FlowPoint& p : bucket)
+                {
+                    queued--;
+                    if (value(p.x, p.y) != current) continue; // stale entry
+                    if (settled) settled->push_back(p);
+
+                    // a neighbour reaches the goals through p paying the cost of p
+                    int32_t d = current + costs.at(p.x, p.y);
+                    for (int k = 0; k < 4; k++)
+                    {
+                        int nx = p.x + FLOW_DX[k];
+                        int ny = p.y + FLOW_DY[k];
+                        if (nx < x0 || nx >= x1 || ny < y0 || ny >= y1) continue;
+                        if (costs.at(nx, ny) == 0) continue;
+                        if (d < value(nx, ny))
+                        {
+                            store(nx, ny, d);
+                            buckets[d % (FLOW_MAX_COST + 1)].push_back(FlowPoint(nx, ny));
+                            queued++;
+                        }
+                    }
+                }
+                bucket.clear();
+                current++;
+            }
+        }
+
+        // cells of a tile whose distance can be lowered from outside the tile,
+        // with the new distance; only reads, the tile applies them itself
+        void borderSeeds(int tx, int ty, std::vector<std::pair<FlowPoint, int32_t> >& seeds) const
+        {
+            int x0 = tx * FLOW_TILE, y0 = ty * FLOW_TILE;
+            int x1 = std::min(x0 + FLOW_TILE, costs.width()), y1 = std::min(y0 + FLOW_TILE, costs.height());
+            for (int y = y0; y < y1; y++)
+            {
+                for (int x = x0; x < x1; x++)
+                {
+                    if (y != y0 && y != y1 - 1 && x != x0 && x != x1 - 1) x = x1 - 1; // skip the inside
+                    if (costs.at(x, y) == 0) continue;
+                    int32_t best = distances.at(x, y);
+                    for (int k = 0; k < 4; k++)
+                    {
+                        int nx = x + FLOW_DX[k], ny = y + FLOW_DY[k];
+                        if (nx >= x0 && nx < x1 && ny >= y0 && ny < y1) continue;
+                        int32_t d = distances.at(nx, ny); // the border reads as unreachable
+                        if (d != FLOW_UNREACHABLE && d + costs.at(nx, ny) < best) best = d + costs.at(nx, ny);
+                    }
+                    if (best < distances.at(x, y)) seeds.push_back(std::make_pair(FlowPoint(x, y), best));
+                }
+            }
+        }
+
+        // distances of the border cells of a tile, to see if a pass changed them
+        void borderValues(int tx, int ty, std::vector<int32_t>& values) const
+        {
+            values.clear();
+            int x0 = tx * FLOW_TILE, y0 = ty * FLOW_TILE;
+            int x1 = std::min(x0 + FLOW_TILE, costs.width()), y1 = std::min(y0 + FLOW_TILE, costs.height());
+            for (int x = x0; x < x1; x++)
+            {
+                values.push_back(distances.at(x, y0));
+                values.push_back(distances.at(x, y1 - 1));
+            }
+            for (int y = y0; y < y1; y++)
+            {
+                values.push_back(distances.at(x0, y));
+                values.push_back(distances.at(x1 - 1, y));
+            }
+        }
+
+        // runs region() on threads threads, the calling one included
+        template <class Region>
+        static void parallelRegion(int threads, Region region)
+        {
+            std::vector<std::thread> pool;
+            for (int t = 1; t < threads; t++) pool.push_back(std::thread(region));
+            region();
+            for (std::thread& t : pool) t.join();
+        }
+
+        // work(i) for every index in [0, count) that no other thread took from next
+        template <class Work>
+        static void claim(std::atomic<int>& next, int count, Work work)
+        {
+            for (int i = next++; i < count; i = next++) work(i);
+        }
+
+        // first step of a cheapest path: the neighbour whose distance plus
+        // its cost is the distance of the cell
+        int8_t bestDirection(int x, int y) const
+        {
+            int32_t here = distances.at(x, y);
+            if (here == FLOW_UNREACHABLE) return FLOW_NO_DIRECTION;
+            for (int k = 0; k < 4; k++)
+            {
+                int nx = x + FLOW_DX[k], ny = y + FLOW_DY[k];
+                int32_t d = distances.at(nx, ny);
+                if (d != FLOW_UNREACHABLE && costs.at(nx, ny) != 0 && d + costs.at(nx, ny) == here) return (int8_t)k;
+            }
+            return FLOW_NO_DIRECTION;
+        }
+
+        bool isGoal(int x, int y) const
+        {
+            for (const FlowPoint& goal : goals)
+            {
+                if (goal.x == x && goal.y == y) return true;
+            }
+            return false;
+        }
+
+        // cheapest distance through the neighbours, FLOW_UNREACHABLE if none has one
+        int32_t distanceFromNeighbours(int x, int y) const
+        {
+            int32_t best = FLOW_UNREACHABLE;
+            for (int k = 0; k < 4; k++)
+            {
+                int nx = x + FLOW_DX[k], ny = y + FLOW_DY[k];
+                int32_t d = value(nx, ny);
+                if (d != FLOW_UNREACHABLE && costs.at(nx, ny) != 0) best = std::min(best, d + costs.at(nx, ny));
+            }
+            return best;
+        }
+
+        void updateDirections(int x0, int y0, int x1, int y1)
+        {
+            for (int y = std::max(y0, 0); y < std::min(y1, costs.height()); y++)
+                for (int x = std::max(x0, 0); x < std::min(x1, costs.width()); x++) directions.at(x, y) = bestDirection(x, y);
+        }
+
+        // a cell whose distance or cost changed and its neighbours may point elsewhere
+        void redirect(const FlowPoint& p)
+        {
+            directions.at(p.x, p.y) = bestDirection(p.x, p.y);
+            for (int k = 0; k < 4; k++)
+            {
+                int nx = p.x + FLOW_DX[k], ny = p.y + FLOW_DY[k];
+                if (costs.inside(nx, ny)) directions.at(nx, ny) = bestDirection(nx, ny);
+            }
+        }
+
+    public:
+        // cost(x, y) returns the cost to enter a cell, 0 for walls
+        template <class CostFn>
+        FlowField(int width, int height, CostFn cost)
+            : costs(width, height, 0, 0),
+              distances(width, height, FLOW_UNREACHABLE, FLOW_UNREACHABLE),
+              directions(width, height, FLOW_NO_DIRECTION, FLOW_NO_DIRECTION),
+              offset(0)
+        {
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++) costs.at(x, y) = (uint8_t)std::min(std::max(cost(x, y), 0), FLOW_MAX_COST);
+        }
+
+        int width() const { return costs.width(); }
+        int height() const { return costs.height(); }
+
+        // full computation from every goal, threads > 1 solves tiles in parallel
+        void compute(const std::vector<FlowPoint>& newGoals, int threads = 1)
+        {
+            distances.fill(FLOW_UNREACHABLE);
+            offset = 0;
+            goals = newGoals;
+
+            std::vector<FlowPoint> seeds;
+            for (const FlowPoint& goal : goals)
+            {
+                if (!costs.inside(goal.x, goal.y) || costs.at(goal.x, goal.y) == 0) continue;
+                distances.at(goal.x, goal.y) = 0;
+                seeds.push_back(goal);
+            }
+
+            if (threads <= 1)
+            {
+                // a single wavefront over the whole map
+                relax(seeds, 0, 0, width(), height());
+                updateDirections(0, 0, width(), height());
+                return;
+            }
+
+            int tileCount = tilesX() * tilesY();
+            std::vector<std::vector<FlowPoint> > tileSeeds(tileCount);
+            for (const FlowPoint& goal : seeds)
+                tileSeeds[(goal.y / FLOW_TILE) * tilesX() + goal.x / FLOW_TILE].push_back(goal);
+
+            std::vector<char> active(tileCount, 0), changed(tileCount, 0);
+            for (int t = 0; t < tileCount; t++) active[t] = changed[t] = !tileSeeds[t].empty();
+            std::vector<std::vector<int32_t> > borders(tileCount);
+            std::vector<std::vector<std::pair<FlowPoint, int32_t> > > borderCells(tileCount);
+
+            // tiles only write their own cells: the seeds are read from the
+            // neighbours' borders before any tile writes
+            auto readBorders = [&](int t)
+            {
+                if (!active[t]) return;
+                int tx = t % tilesX(), ty = t / tilesX();
+                borderValues(tx, ty, borders[t]);
+                borderSeeds(tx, ty, borderCells[t]);
+            };
+            bool first = true;
+            auto relaxTile = [&](int t)
+            {
+                if (!active[t]) return;
+                for (const std::pair<FlowPoint, int32_t>& cell : borderCells[t])
+                {
+                    distances.at(cell.first.x, cell.first.y) = cell.second;
+                    tileSeeds[t].push_back(cell.first);
+                }
+                borderCells[t].clear();
+                if (!tileSeeds[t].empty())
+                {
+                    int x0 = t % tilesX() * FLOW_TILE, y0 = t / tilesX() * FLOW_TILE;
+                    relax(tileSeeds[t], x0, y0, std::min(x0 + FLOW_TILE, width()), std::min(y0 + FLOW_TILE, height()));
+                    tileSeeds[t].clear();
+                }
+                // the goals were set before the first snapshot
+                if (!first)
+                {
+                    std::vector<int32_t> after;
+                    borderValues(t % tilesX(), t / tilesX(), after);
+                    changed[t] = after != borders[t];
+                }
+            };
+            // wake up the neighbours of every tile whose border changed
+            bool any = true;
+            auto wake = [&]()
+            {
+                first = false;
+                any = false;
+                std::fill(active.begin(), active.end(), 0);
+                for (int t = 0; t < tileCount; t++)
+                {
+                    if (!changed[t]) continue;
+                    changed[t] = 0;
+                    int tx = t % tilesX(), ty = t / tilesX();
+                    for (int k = 0; k < 4; k++)
+                    {
+                        int nx = tx + FLOW_DX[k], ny = ty + FLOW_DY[k];
+                        if (nx < 0 || nx >= tilesX() || ny < 0 || ny >= tilesY()) continue;
+                        active[ny * tilesX() + nx] = 1;
+                        any = true;
+                    }
+                }
+            };
+
+            // The threads are started once for the whole computation and
+            // take tiles from a shared counter. They wait for each other
+            // after reading the borders and after relaxing, where the last
+            // one resets the counter and wakes up the next pass.
+            threads = std::min(threads, tileCount);
+            std::atomic<int> next(0);
+            FlowBarrier barrier(threads);
+            parallelRegion(threads, [&]()
+            {
+                while (true)
+                {
+                    claim(next, tileCount, readBorders);
+                    barrier.wait([&]() { next = 0; });
+                    claim(next, tileCount, relaxTile);
+                    barrier.wait([&]() { next = 0; wake(); });
+                    if (!any) break;
+                }
+                claim(next, tilesY(), [&](int ty) { updateDirections(0, ty * FLOW_TILE, width(), (ty + 1) * FLOW_TILE); });
+            });
+        }
+
+        // The only goal moved from one cell to a neighbour. Every old distance
+        // plus the cost of the step is still a valid path, so the field only
+        // needs that constant added (O(1) through offset) and a wavefront from
+        // the new goal over the cells that got closer. Anything else falls
+        // back to compute().
+        void moveGoal(FlowPoint from, FlowPoint to)
+        {
+            if (std::abs(from.x - to.x) + std::abs(from.y - to.y) != 1 ||
+                !costs.inside(from.x, from.y) || !costs.inside(to.x, to.y) ||
+                costs.at(to.x, to.y) == 0 || value(from.x, from.y) != 0 ||
+                offset > INT32_MAX / 2)
+            {
+                compute(std::vector<FlowPoint>(1, to));
+                return;
+            }
+
+            offset += costs.at(to.x, to.y);
+            store(to.x, to.y, 0);
+            goals.assign(1, to);
+
+            std::vector<FlowPoint> changedCells;
+            relax(std::vector<FlowPoint>(1, to), 0, 0, width(), height(), &changedCells);
+
+            // only changed cells and their neighbours can point elsewhere
+            for (const FlowPoint& p : changedCells) redirect(p);
+            directions.at(from.x, from.y) = bestDirection(from.x, from.y);
+        }
+
+        // Reads the costs of a changed region again and repairs the field.
+        // Cells whose cheapest path entered a cell that got more expensive or
+        // blocked are cleared and filled again from their surroundings; cells
+        // that got cheaper spread their shorter paths. The work follows the
+        // cells whose distance changes, not the map size.
+        template <class CostFn>
+        void updateCosts(const CellRect& region, CostFn cost)
+        {
+            std::vector<FlowPoint> raised, lowered;
+            for (int y = std::max(region.y0, 0); y < std::min(region.y1, height()); y++)
+            {
+                for (int x = std::max(region.x0, 0); x < std::min(region.x1, width()); x++)
+                {
+                    int newCost = std::min(std::max(cost(x, y), 0), FLOW_MAX_COST);
+                    int oldCost = costs.at(x, y);
+                    if (newCost == oldCost) continue;
+                    costs.at(x, y) = (uint8_t)newCost;
+                    if (newCost == 0 || (oldCost != 0 && newCost > oldCost)) raised.push_back(FlowPoint(x, y));
+                    else lowered.push_back(FlowPoint(x, y));
+                }
+            }
+            if (raised.empty() && lowered.empty()) return;
+
+            // every cell whose direction chain runs into a raised cell
+            std::vector<FlowPoint> cleared;
+            Grid<bool> inCleared(width(), height(), false, false);
+            auto clear = [&](int x, int y)
+            {
+                if (inCleared.at(x, y)) return;
+                inCleared.at(x, y) = true;
+                cleared.push_back(FlowPoint(x, y));
+            };
+            for (const FlowPoint& p : raised)
+            {
+                if (costs.at(p.x, p.y) == 0) clear(p.x, p.y);
+                for (int k = 0; k < 4; k++)
+                {
+                    int nx = p.x - FLOW_DX[k], ny = p.y - FLOW_DY[k];
+                    if (costs.inside(nx, ny) && directions.at(nx, ny) == k) clear(nx, ny);
+                }
+            }
+            for (size_t i = 0; i < cleared.size(); i++)
+            {
+                FlowPoint p = cleared[i];
+                for (int k = 0; k < 4; k++)
+                {
+                    int nx = p.x - FLOW_DX[k], ny = p.y - FLOW_DY[k];
+                    if (costs.inside(nx, ny) && directions.at(nx, ny) == k) clear(nx, ny);
+                }
+            }
+            for (const FlowPoint& p : cleared)
+            {
+                distances.at(p.x, p.y) = FLOW_UNREACHABLE;
+                directions.at(p.x, p.y) = FLOW_NO_DIRECTION;
+            }
+
+            // refill the cleared cells and open cells from what is still valid
+            std::vector<FlowPoint> seeds;
+            auto reseed = [&](const FlowPoint& p)
+            {
+                if (costs.at(p.x, p.y) == 0) return;
+                int32_t d = isGoal(p.x, p.y) ? 0 : distanceFromNeighbours(p.x, p.y);
+                if (d == FLOW_UNREACHABLE) return;
+                if (d < value(p.x, p.y)) store(p.x, p.y, d);
+                seeds.push_back(p);
+            };
+            for (const FlowPoint& p : cleared) reseed(p);
+            for (const FlowPoint& p : lowered) reseed(p);
+
+            std::vector<FlowPoint> changedCells;
+            relax(seeds, 0, 0, width(), height(), &changedCells);
+
+            // directions of everything touched and of the cells next to it
+            for (const FlowPoint& p : cleared) redirect(p);
+            for (const FlowPoint& p : changedCells) redirect(p);
+            for (const FlowPoint& p : raised) redirect(p);
+            for (const FlowPoint& p : lowered) redirect(p);
+        }
+
+        // cost of the cheapest path to a goal, FLOW_UNREACHABLE if there is none
+        int32_t distance(int x, int y) const
+        {
+            return costs.inside(x, y) ? value(x, y) : FLOW_UNREACHABLE;
+        }
+
+        // index into FLOW_DX / FLOW_DY, FLOW_NO_DIRECTION on goals and unreachable cells
+        int8_t direction(int x, int y) const
+        {
+            return directions.get(x, y);
+        }
+
+        // next move of an agent standing on (x, y), false if it can't get closer
+        bool nextStep(int x, int y, int& dx, int& dy) const
+        {
+            int8_t k = direction(x, y);
+            if (k == FLOW_NO_DIRECTION) return false;
+            dx = FLOW_DX[k];
+            dy = FLOW_DY[k];
+            return true;
+        }
+};
+
+#endif
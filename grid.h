@@ -0,0 +1,231 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Tile grid shared by the three programs.
+// Cells are stored with a one-cell sentinel border around the map, so any
+// cell from (-1, -1) to (width, height) can be read without bounds checks;
+// neighbourhood loops (FOV, flood fill, dilation) never test coordinates.
+// The memory layout is a template parameter and the dimensions can be fixed
+// at compile time or chosen at runtime.
+
+const int DynamicSize = -1;
+const int GRID_BORDER = 1;
+
+// rows one after another
+struct RowMajor
+{
+    static size_t storageSize(int width, int height)
+    {
+        return (size_t)width * height;
+    }
+
+    static size_t index(int x, int y, int width, int /*height*/)
+    {
+        return (size_t)y * width + x;
+    }
+};
+
+// square tiles stored one after another, cells row-major inside each tile;
+// a 3x3 neighbourhood touches at most four tiles instead of three long rows
+template <int TileSize = 8>
+struct Tiled
+{
+    static_assert((TileSize & (TileSize - 1)) == 0, "TileSize must be a power of two");
+
+    static int tiles(int size) { return (size + TileSize - 1) / TileSize; }
+
+    static size_t storageSize(int width, int height)
+    {
+        return (size_t)tiles(width) * tiles(height) * TileSize * TileSize;
+    }
+
+    static size_t index(int x, int y, int width, int /*height*/)
+    {
+        size_t tile = (size_t)(y / TileSize) * tiles(width) + x / TileSize;
+        return tile * TileSize * TileSize + (y % TileSize) * TileSize + x % TileSize;
+    }
+};
+
+// 8x8 tiles like Tiled<8>, cells in Z-order (Morton) inside each tile so
+// close cells stay close in both directions; memory stays proportional to
+// the grid instead of rounding it up to a power-of-two square
+struct Morton
+{
+    static int tiles(int size) { return (size + 7) / 8; }
+
+    // spreads the 3 low bits of v to bits 0, 2 and 4
+    static size_t spread(int v)
+    {
+        return (v & 1) | ((v & 2) << 1) | ((v & 4) << 2);
+    }
+
+    static size_t storageSize(int width, int height)
+    {
+        return (size_t)tiles(width) * tiles(height) * 64;
+    }
+
+    static size_t index(int x, int y, int width, int /*height*/)
+    {
+        size_t tile = (size_t)(y / 8) * tiles(width) + x / 8;
+        return tile * 64 + (spread(x % 8) | (spread(y % 8) << 1));
+    }
+};
+
+// Width and height: compile-time constants or runtime members
+template <int W, int H>
+struct GridExtent
+{
+    GridExtent(int, int) {}
+    void set(int, int) {}
+    int width() const { return W; }
+    int height() const { return H; }
+};
+
+template <>
+struct GridExtent<DynamicSize, DynamicSize>
+{
+    int w, h;
+    GridExtent(int width, int height) : w(width), h(height) {}
+    void set(int width, int height) { w = width; h = height; }
+    int width() const { return w; }
+    int height() const { return h; }
+};
+
+template <class T, class Layout = RowMajor, int W = DynamicSize, int H = DynamicSize>
+class Grid
+{
+    static_assert((W == DynamicSize) == (H == DynamicSize), "both dimensions must be fixed or both dynamic");
+
+    private:
+        GridExtent<W, H> extent;
+        std::unique_ptr<T[]> cells; // padded grid, see storageIndex
+        size_t cellCount;
+        T sentinel;
+
+        // position of (x, y) in the storage, valid from -GRID_BORDER to size - 1 + GRID_BORDER
+        size_t storageIndex(int x, int y) const
+        {
+            return Layout::index(x + GRID_BORDER, y + GRID_BORDER,
+                                 extent.width() + 2 * GRID_BORDER, extent.height() + 2 * GRID_BORDER);
+        }
+
+        void allocate(T fillValue)
+        {
+            cellCount = Layout::storageSize(extent.width() + 2 * GRID_BORDER, extent.height() + 2 * GRID_BORDER);
+            cells.reset(new T[cellCount]);
+            std::fill(cells.get(), cells.get() + cellCount, sentinel);
+            fill(fillValue);
+        }
+
+    public:
+        // W x H for fixed grids, 0 x 0 for dynamic ones
+        Grid() : extent(W == DynamicSize ? 0 : W, H == DynamicSize ? 0 : H), cellCount(0), sentinel(T())
+        {
+            allocate(T());
+        }
+
+        // for fixed grids width and height must be W and H
+        Grid(int width, int height, T fillValue = T(), T sentinelValue = T())
+            : extent(width, height), cellCount(0), sentinel(sentinelValue)
+        {
+            assert(W == DynamicSize || (width == W && height == H));
+            allocate(fillValue);
+        }
+
+        Grid(const Grid& other) : extent(other.extent), cellCount(other.cellCount), sentinel(other.sentinel)
+        {
+            cells.reset(new T[cellCount]);
+            std::copy(other.cells.get(), other.cells.get() + cellCount, cells.get());
+        }
+
+        // the moved-from grid is left empty, 0 x 0 when dynamic
+        Grid(Grid&& other)
+            : extent(other.extent), cells(std::move(other.cells)), cellCount(other.cellCount), sentinel(other.sentinel)
+        {
+            other.extent.set(0, 0);
+            other.cellCount = 0;
+        }
+
+        Grid& operator=(Grid&& other)
+        {
+            if (this == &other) return *this;
+            extent = other.extent;
+            cells = std::move(other.cells);
+            cellCount = other.cellCount;
+            sentinel = other.sentinel;
+            other.extent.set(0, 0);
+            other.cellCount = 0;
+            return *this;
+        }
+
+        Grid& operator=(const Grid& other)
+        {
+            if (this == &other) return *this;
+            if (!cells || cellCount != other.cellCount) cells.reset(new T[other.cellCount]);
+            extent = other.extent;
+            cellCount = other.cellCount;
+            sentinel = other.sentinel;
+            std::copy(other.cells.get(), other.cells.get() + cellCount, cells.get());
+            return *this;
+        }
+
+        // new dimensions (dynamic grids only), every cell is reset
+        void resize(int width, int height, T fillValue = T())
+        {
+            static_assert(W == DynamicSize, "a fixed grid can't be resized");
+            extent.set(width, height);
+            allocate(fillValue);
+        }
+
+        int width() const { return extent.width(); }
+        int height() const { return extent.height(); }
+
+        bool inside(int x, int y) const
+        {
+            return x >= 0 && x < width() && y >= 0 && y < height();
+        }
+
+        // unchecked access, valid inside the map and on the sentinel border
+        T& at(int x, int y) { return cells[storageIndex(x, y)]; }
+        const T& at(int x, int y) const { return cells[storageIndex(x, y)]; }
+
+        // checked read, the sentinel for any cell outside the map
+        T get(int x, int y) const
+        {
+            return inside(x, y) ? at(x, y) : sentinel;
+        }
+
+        // checked write, cells outside the map are ignored
+        void set(int x, int y, T value)
+        {
+            if (inside(x, y)) at(x, y) = value;
+        }
+
+        // sets every cell of the map (not the border)
+        void fill(T value)
+        {
+            for (int y = 0; y < height(); y++)
+                for (int x = 0; x < width(); x++) at(x, y) = value;
+        }
+
+        // contiguous cells of row y (row-major layout only)
+        T* row(int y)
+        {
+            static_assert(std::is_same<Layout, RowMajor>::value, "rows are only contiguous in RowMajor grids");
+            return &at(0, y);
+        }
+        const T* row(int y) const
+        {
+            static_assert(std::is_same<Layout, RowMajor>::value, "rows are only contiguous in RowMajor grids");
+            return &at(0, y);
+        }
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "spsc_queue.h"
+
+// key press or release read from the console
+struct InputEvent
+{
+    uint64_t time; // steady clock, nanoseconds
+    uint16_t key;  // virtual key code (VK_LSHIFT / VK_LCONTROL for the left modifiers)
+    bool down;     // true = press, false = release
+};
+
+// Keyboard input read by a dedicated thread.
+// The reader thread timestamps every press and release and pushes it into a
+// lock-free queue; the game thread drains it once per tick and gets edges
+// (pressed / released during the tick) besides the current state, so a tap
+// shorter than a frame is never lost.
+class InputSystem
+{
+    private:
+        SpscQueue<InputEvent, 1024> events; // reader thread -> game thread
+        std::thread reader;
+        std::atomic<bool> running;
+
+        bool down[256];     // key is held
+        bool pressed[256];  // key went down during the last tick
+        bool released[256]; // key went up during the last tick
+
+        static uint64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // the left modifiers arrive as VK_SHIFT / VK_CONTROL
+        static uint16_t translateKey(const KEY_EVENT_RECORD& key)
+        {
+            if (key.wVirtualKeyCode == VK_SHIFT && key.wVirtualScanCode == 0x2A) return VK_LSHIFT;
+            if (key.wVirtualKeyCode == VK_CONTROL && !(key.dwControlKeyState & ENHANCED_KEY)) return VK_LCONTROL;
+            return key.wVirtualKeyCode;
+        }
+
+        // reader thread
+        void readLoop()
+        {
+            HANDLE console = GetStdHandle(STD_INPUT_HANDLE);
+            INPUT_RECORD records[32];
+            while (running.load(std::memory_order_relaxed))
+            {
+                // wake up regularly to notice stop()
+                if (WaitForSingleObject(console, 10) != WAIT_OBJECT_0) continue;
+
+                DWORD count = 0;
+                if (!ReadConsoleInput(console, records, 32, &count)) continue;
+                uint64_t time = now();
+
+                for (DWORD i = 0; i < count; i++)
+                {
+                    if (records[i].EventType != KEY_EVENT) continue;
+                    const KEY_EVENT_RECORD& key = records[i].Event.KeyEvent;
+
+                    InputEvent event;
+                    event.time = time;
+                    event.key = translateKey(key) & 0xFF;
+                    event.down = key.bKeyDown != 0;
+                    // the queue only fills up if the game stops ticking for a long time
+                    events.push(event);
+                }
+            }
+        }
+
+    public:
+        InputSystem() : running(false)
+        {
+            for (int i = 0; i < 256; i++) down[i] = pressed[i] = released[i] = false;
+        }
+
+        ~InputSystem()
+        {
+            stop();
+        }
+
+        // starts the reader thread
+        void start()
+        {
+            if (running) return;
+            running = true;
+            reader = std::thread(&InputSystem::readLoop, this);
+        }
+
+        // stops the reader thread
+        void stop()
+        {
+            running = false;
+            if (reader.joinable()) reader.join();
+        }
+
+        // Applies the events that happened up to tickTime, call once per tick
+        void update(uint64_t tickTime = now())
+        {
+            for (int i = 0; i < 256; i++) pressed[i] = released[i] = false;
+
+            while (const InputEvent* event = events.peek())
+            {
+                // leave events after this tick for the next one
+                if (event->time > tickTime) break;
+
+                // key repeat sends presses while held, only the first one is an edge
+                if (event->down && !down[event->key]) pressed[event->key] = true;
+                if (!event->down && down[event->key]) released[event->key] = true;
+                down[event->key] = event->down;
+
+                InputEvent consumed;
+                events.pop(consumed);
+            }
+        }
+
+        bool isDown(int key) const { return down[key & 0xFF]; }
+        bool wasPressed(int key) const { return pressed[key & 0xFF]; }
+        bool wasReleased(int key) const { return released[key & 0xFF]; }
+
+        // held now or tapped during the tick
+        bool isActive(int key) const { return down[key & 0xFF] || pressed[key & 0xFF]; }
+};
+
+#endif
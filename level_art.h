@@ -0,0 +1,136 @@
+#ifndef LEVEL_ART_H
+#define LEVEL_ART_H
+
+#include <cstdint>
+
+// Built-in levels drawn as ASCII art and baked by the compiler.
+// bakeLevel turns a string literal, one line per row, into a constant with
+// the cells and a wall bitmask per row, so none of it is built at startup
+// and all of it sits in read-only memory. The art is checked with
+// static_assert: rows of the same width and walls on every side. '@' marks
+// the player start and bakes as floor.
+//
+//   constexpr char art[] = R"(
+//   #####
+//   #.@.#
+//   #####)";
+//   constexpr auto level = bakeLevel<art, '#', '.'>();
+//
+// A leading newline is skipped so raw literals can start on their own line.
+
+constexpr const char* artBegin(const char* art)
+{
+    return *art == '\n' ? art + 1 : art;
+}
+
+constexpr int artWidth(const char* art)
+{
+    const char* p = artBegin(art);
+    int width = 0;
+    while (p[width] && p[width] != '\n') width++;
+    return width;
+}
+
+// a trailing newline doesn't start another row
+constexpr int artHeight(const char* art)
+{
+    const char* p = artBegin(art);
+    if (!*p) return 0;
+    int height = 1;
+    for (; *p; p++)
+    {
+        if (*p == '\n' && p[1]) height++;
+    }
+    return height;
+}
+
+constexpr bool artRectangular(const char* art)
+{
+    int width = artWidth(art), x = 0;
+    for (const char* p = artBegin(art); *p; p++)
+    {
+        if (*p != '\n') x++;
+        else if (x != width) return false;
+        else x = 0;
+    }
+    return x == width || x == 0;
+}
+
+// cell of rectangular art
+constexpr char artCell(const char* art, int width, int x, int y)
+{
+    return artBegin(art)[y * (width + 1) + x];
+}
+
+constexpr bool artBordered(const char* art, char wall)
+{
+    if (!artRectangular(art)) return false;
+    int width = artWidth(art), height = artHeight(art);
+    for (int x = 0; x < width; x++)
+    {
+        if (artCell(art, width, x, 0) != wall || artCell(art, width, x, height - 1) != wall) return false;
+    }
+    for (int y = 0; y < height; y++)
+    {
+        if (artCell(art, width, 0, y) != wall || artCell(art, width, width - 1, y) != wall) return false;
+    }
+    return true;
+}
+
+template <int W, int H>
+struct BakedLevel
+{
+    static constexpr int width = W;
+    static constexpr int height = H;
+    static constexpr int wordsPerRow = (W + 63) / 64;
+
+    char cells[H][W];
+    uint64_t walls[H][wordsPerRow];   // bit x % 64 of word x / 64 set for a wall
+    int startX, startY;               // '@' in the art, -1 without one
+
+    constexpr BakedLevel(const char* art, char wall, char floor)
+        : cells(), walls(), startX(-1), startY(-1)
+    {
+        for (int y = 0; y < H; y++)
+        {
+            for (int x = 0; x < W; x++)
+            {
+                char c = artCell(art, W, x, y);
+                if (c == '@')
+                {
+                    startX = x;
+                    startY = y;
+                    c = floor;
+                }
+                cells[y][x] = c;
+                if (c == wall) walls[y][x / 64] |= 1ULL << (x % 64);
+            }
+        }
+    }
+
+    // outside the level is solid
+    constexpr bool solid(int x, int y) const
+    {
+        if (x < 0 || x >= W || y < 0 || y >= H) return true;
+        return (walls[y][x / 64] >> (x % 64)) & 1;
+    }
+
+    // writes the cells into a runtime grid (at(x, y) of the right size)
+    template <class GridType>
+    void copyTo(GridType& grid) const
+    {
+        for (int y = 0; y < H; y++)
+            for (int x = 0; x < W; x++) grid.at(x, y) = cells[y][x];
+    }
+};
+
+template <const char* Art, char Wall = '#', char Floor = ' '>
+constexpr BakedLevel<artWidth(Art), artHeight(Art)> bakeLevel()
+{
+    static_assert(artWidth(Art) > 0 && artHeight(Art) > 0, "the level art is empty");
+    static_assert(artRectangular(Art), "every row of the level art must be as wide as the first");
+    static_assert(artBordered(Art, Wall), "the level art must have walls on every side");
+    return BakedLevel<artWidth(Art), artHeight(Art)>(Art, Wall, Floor);
+}
+
+#endif
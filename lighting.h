@@ -0,0 +1,279 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+#include "map_changes.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Point lights over a tile map.
+// Every light keeps its own contribution: a (2r+1)^2 square computed with
+// recursive shadowcasting, brightest at the light and fading to 0 past the
+// radius. The light level of a cell is the saturating sum of the
+// contributions that reach it.
+//
+// Nothing is recomputed when it changes: moving a light, adding one or
+// changing a wall only marks rectangles dirty. update() shadowcasts again the
+// lights whose own view changed and re-adds, inside the dirty rectangles
+// only, the lights overlapping them.
+
+struct Light
+{
+    int x, y;
+    int radius;
+    uint8_t intensity; // level at the light itself
+
+    Light(int _x = 0, int _y = 0, int _radius = 6, uint8_t _intensity = 255)
+        : x(_x), y(_y), radius(_radius), intensity(_intensity) {}
+};
+
+// dst[i] = min(dst[i] + src[i], 255), 16 cells per instruction with SSE2
+inline void saturatingAdd(uint8_t* dst, const uint8_t* src, int count)
+{
+    int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i sum = _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(dst + i)), _mm_loadu_si128((const __m128i*)(src + i)));
+        _mm_storeu_si128((__m128i*)(dst + i), sum);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        unsigned sum = dst[i] + src[i];
+        dst[i] = (uint8_t)(sum > 255 ? 255 : sum);
+    }
+}
+
+class LightMap
+{
+    private:
+        struct Source
+        {
+            Light light;
+            bool active;
+            bool stale;                   // contribution must be shadowcast again
+            std::vector<uint8_t> levels;  // contribution, (2r+1)^2 centered on the light
+
+            int size() const { return 2 * light.radius + 1; }
+            CellRect volume() const
+            {
+                return CellRect(light.x - light.radius, light.y - light.radius,
+                            light.x + light.radius + 1, light.y + light.radius + 1);
+            }
+        };
+
+        Grid<bool> opaque;   // outside the map is opaque
+        Grid<uint8_t> light; // summed light level
+        std::vector<Source> sources;
+        std::vector<CellRect> dirty;
+
+        CellRect clip(CellRect r) const
+        {
+            return CellRect(std::max(r.x0, 0), std::max(r.y0, 0), std::min(r.x1, light.width()), std::min(r.y1, light.height()));
+        }
+
+        void markDirty(const CellRect& r)
+        {
+            CellRect clipped = clip(r);
+            if (!clipped.empty()) dirty.push_back(clipped);
+        }
+
+        // one octant of recursive shadowcasting (slopes from start down to end)
+        void castOctant(Source& source, int row, double start, double end, int xx, int xy, int yx, int yy)
+        {
+            if (start < end) return;
+            const Light& l = source.light;
+            int size = source.size();
+            double newStart = 0;
+            for (int j = row; j <= l.radius; j++)
+            {
+                bool blocked = false;
+                int dy = -j;
+                for (int dx = -j; dx <= 0; dx++)
+                {
+                    double leftSlope = (dx - 0.5) / (dy + 0.5);
+                    double rightSlope = (dx + 0.5) / (dy - 0.5);
+                    if (start < rightSlope) continue;
+                    if (end > leftSlope) break;
+
+                    int ox = dx * xx + dy * xy;
+                    int oy = dx * yx + dy * yy;
+                    if (dx * dx + dy * dy <= l.radius * l.radius)
+                    {
+                        double distance = std::sqrt((double)(dx * dx + dy * dy));
+                        source.levels[(oy + l.radius) * size + ox + l.radius] =
+                            (uint8_t)(l.intensity * (1.0 - distance / (l.radius + 1)));
+                    }
+
+                    bool wall = opaque.get(l.x + ox, l.y + oy);
+                    if (blocked)
+                    {
+                        if (wall)
+                        {
+                            newStart = rightSlope;
+                            continue;
+                        }
+                        blocked = false;
+                        start = newStart;
+                    }
+                    else if (wall && j < l.radius)
+                    {
+                        // light goes on beside the wall
+                        blocked = true;
+                        castOctant(source, j + 1, start, leftSlope, xx, xy, yx, yy);
+                        newStart = rightSlope;
+                    }
+                }
+                if (blocked) break;
+            }
+        }
+
+        void shadowcast(Source& source)
+        {
+            static const int multipliers[4][8] = {
+                { 1, 0, 0, -1, -1, 0, 0, 1 },
+                { 0, 1, -1, 0, 0, -1, 1, 0 },
+                { 0, 1, 1, 0, 0, -1, -1, 0 },
+                { 1, 0, 0, 1, -1, 0, 0, -1 }
+            };
+            int size = source.size();
+            source.levels.assign((size_t)size * size, 0);
+            source.levels[source.light.radius * size + source.light.radius] = source.light.intensity;
+            for (int octant = 0; octant < 8; octant++)
+            {
+                castOctant(source, 1, 1.0, 0.0, multipliers[0][octant], multipliers[1][octant],
+                           multipliers[2][octant], multipliers[3][octant]);
+            }
+            source.stale = false;
+        }
+
+        // sums every light overlapping r into the light buffer
+        void accumulate(const CellRect& r)
+        {
+            for (int y = r.y0; y < r.y1; y++) std::fill(light.row(y) + r.x0, light.row(y) + r.x1, 0);
+
+            for (const Source& source : sources)
+            {
+                if (!source.active) continue;
+                CellRect volume = source.volume();
+                if (!volume.overlaps(r)) continue;
+                int x0 = std::max(r.x0, volume.x0), x1 = std::min(r.x1, volume.x1);
+                int y0 = std::max(r.y0, volume.y0), y1 = std::min(r.y1, volume.y1);
+                int size = source.size();
+                for (int y = y0; y < y1; y++)
+                {
+                    const uint8_t* levels = &source.levels[(size_t)(y - volume.y0) * size + (x0 - volume.x0)];
+                    saturatingAdd(light.row(y) + x0, levels, x1 - x0);
+                }
+            }
+        }
+
+    public:
+        // opaqueCell(x, y) is true for cells that stop light (walls)
+        template <class OpaqueFn>
+        LightMap(int width, int height, OpaqueFn opaqueCell)
+            : opaque(width, height, false, true), light(width, height, 0, 0)
+        {
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++) opaque.at(x, y) = opaqueCell(x, y);
+        }
+
+        int width() const { return light.width(); }
+        int height() const { return light.height(); }
+
+        // returns the id used by moveLight and removeLight
+        int addLight(const Light& l)
+        {
+            Source source;
+            source.light = l;
+            source.active = true;
+            source.stale = true;
+            sources.push_back(source);
+            markDirty(source.volume());
+            return (int)sources.size() - 1;
+        }
+
+        void moveLight(int id, int x, int y)
+        {
+            Source& source = sources[id];
+            if (source.light.x == x && source.light.y == y) return;
+            markDirty(source.volume());
+            source.light.x = x;
+            source.light.y = y;
+            source.stale = true;
+            markDirty(source.volume());
+        }
+
+        void removeLight(int id)
+        {
+            if (!sources[id].active) return;
+            sources[id].active = false;
+            sources[id].levels.clear();
+            markDirty(sources[id].volume());
+        }
+
+        const Light& getLight(int id) const { return sources[id].light; }
+        int lightCount() const { return (int)sources.size(); }
+
+        // a wall appeared or disappeared: the lights that can reach it cast again
+        void setOpaque(int x, int y, bool value)
+        {
+            if (!opaque.inside(x, y) || opaque.at(x, y) == value) return;
+            opaque.at(x, y) = value;
+            CellRect cell(x, y, x + 1, y + 1);
+            for (Source& source : sources)
+            {
+                if (!source.active || !source.volume().overlaps(cell)) continue;
+                source.stale = true;
+                markDirty(source.volume());
+            }
+        }
+
+        // re-reads the walls of a changed map region
+        template <class OpaqueFn>
+        void refresh(const CellRect& r, OpaqueFn opaqueCell)
+        {
+            for (int y = std::max(r.y0, 0); y < std::min(r.y1, height()); y++)
+                for (int x = std::max(r.x0, 0); x < std::min(r.x1, width()); x++) setOpaque(x, y, opaqueCell(x, y));
+        }
+
+        // recomputes what the changes since the last call made dirty
+        void update()
+        {
+            if (dirty.empty()) return;
+
+            for (Source& source : sources)
+            {
+                if (source.active && source.stale) shadowcast(source);
+            }
+
+            // overlapping rectangles are merged so no cell is summed twice
+            std::vector<CellRect> regions = mergeRects(dirty, false);
+            dirty.clear();
+
+            for (const CellRect& r : regions) accumulate(r);
+        }
+
+        // recomputes every light and the whole buffer
+        void rebuild()
+        {
+            for (Source& source : sources) source.stale = true;
+            dirty.clear();
+            markDirty(CellRect(0, 0, width(), height()));
+            update();
+        }
+
+        uint8_t level(int x, int y) const
+        {
+            return light.get(x, y);
+        }
+};
+
+#endif
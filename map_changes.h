@@ -0,0 +1,165 @@
+#ifndef MAP_CHANGES_H
+#define MAP_CHANGES_H
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Change notifications for maps edited during play.
+// A map records every cell written by setCell; at the end of a batch (or
+// right away outside of one) the changed cells are merged into a few
+// rectangles and every listener is told about each of them, so caches built
+// from the map (visibility, light, flow fields, render buffers) rebuild only
+// that region.
+
+// cells [x0, x1) x [y0, y1)
+struct CellRect
+{
+    int x0, y0, x1, y1;
+
+    CellRect(int _x0 = 0, int _y0 = 0, int _x1 = 0, int _y1 = 0) : x0(_x0), y0(_y0), x1(_x1), y1(_y1) {}
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    bool contains(int x, int y) const { return x >= x0 && x < x1 && y >= y0 && y < y1; }
+
+    bool overlaps(const CellRect& other) const
+    {
+        return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+    }
+
+    // overlapping or sharing an edge
+    bool touches(const CellRect& other) const
+    {
+        return x0 <= other.x1 && other.x0 <= x1 && y0 <= other.y1 && other.y0 <= y1;
+    }
+
+    CellRect merged(const CellRect& other) const
+    {
+        return CellRect(std::min(x0, other.x0), std::min(y0, other.y0), std::max(x1, other.x1), std::max(y1, other.y1));
+    }
+
+    // grown by margin cells on every side
+    CellRect grown(int margin) const
+    {
+        return CellRect(x0 - margin, y0 - margin, x1 + margin, y1 + margin);
+    }
+};
+
+// rects joined until no two overlap, or with touching no two share an edge either
+inline std::vector<CellRect> mergeRects(const std::vector<CellRect>& rects, bool touching)
+{
+    std::vector<CellRect> regions;
+    for (CellRect r : rects)
+    {
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+            for (size_t i = 0; i < regions.size(); i++)
+            {
+                if (touching ? !regions[i].touches(r) : !regions[i].overlaps(r)) continue;
+                r = r.merged(regions[i]);
+                regions.erase(regions.begin() + i);
+                merged = true;
+                break;
+            }
+        }
+        regions.push_back(r);
+    }
+    return regions;
+}
+
+class ChangeTracker
+{
+    public:
+        typedef std::function<void(const CellRect&)> Listener;
+
+    private:
+        std::vector<std::pair<int, Listener> > listeners;
+        int nextId;
+        std::vector<CellRect> pending;
+        int depth; // nested batches
+
+    public:
+        ChangeTracker() : nextId(0), depth(0) {}
+
+        // listeners belong to the map they subscribed to, copies start without any
+        ChangeTracker(const ChangeTracker&) : nextId(0), depth(0) {}
+        ChangeTracker& operator=(const ChangeTracker&)
+        {
+            listeners.clear();
+            pending.clear();
+            depth = 0;
+            return *this;
+        }
+
+        // returns the id for unsubscribe
+        int subscribe(Listener listener)
+        {
+            listeners.push_back(std::make_pair(nextId, listener));
+            return nextId++;
+        }
+
+        void unsubscribe(int id)
+        {
+            for (size_t i = 0; i < listeners.size(); i++)
+            {
+                if (listeners[i].first == id)
+                {
+                    listeners.erase(listeners.begin() + i);
+                    return;
+                }
+            }
+        }
+
+        void begin() { depth++; }
+
+        // true when the outermost batch ends and the changes must be applied
+        bool end()
+        {
+            if (depth > 0) depth--;
+            return depth == 0;
+        }
+
+        bool batching() const { return depth > 0; }
+
+        void add(const CellRect& r)
+        {
+            if (!r.empty()) pending.push_back(r);
+        }
+
+        void add(int x, int y) { add(CellRect(x, y, x + 1, y + 1)); }
+
+        // pending changes as rectangles that don't touch each other
+        std::vector<CellRect> take()
+        {
+            std::vector<CellRect> regions = mergeRects(pending, true);
+            pending.clear();
+            return regions;
+        }
+
+        void notify(const CellRect& r) const
+        {
+            for (const std::pair<int, Listener>& listener : listeners) listener.second(r);
+        }
+};
+
+// Scope that batches the changes of a map: listeners hear about them once,
+// when the outermost batch ends.
+//   { ChangeBatch<walk::Map> batch(map); map.setCell(...); map.setCell(...); }
+template <class MapType>
+class ChangeBatch
+{
+    private:
+        MapType& map;
+
+    public:
+        ChangeBatch(MapType& changedMap) : map(changedMap) { map.beginChanges(); }
+        ~ChangeBatch() { map.endChanges(); }
+
+        ChangeBatch(const ChangeBatch&) = delete;
+        ChangeBatch& operator=(const ChangeBatch&) = delete;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef MAP_PROTOCOL_H
+#define MAP_PROTOCOL_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Binary protocol of mapd, the map query daemon (mapd.cpp).
+// Local only (Unix socket), so every field is in host byte order.
+//
+// Request:  uint32 size | uint32 id | uint16 op     | uint16 count | payload
+// Response: uint32 size | uint32 id | uint16 status | uint16 count | payload
+//
+// size counts the bytes after itself. A client can send many requests
+// without waiting (pipelining); responses carry the request id and may
+// arrive in a different order.
+//
+//   OP_INFO      -                                   int32 width, height, shared memory name
+//   OP_CELL      count x { int32 x, y }              count tile bytes
+//   OP_LOS       count x { float x1, y1; int32 x2, y2 }  count bytes, 1 = line of sight
+//   OP_FOV       float x, y, angle                   visible cells, one bit per cell, row-major
+//   OP_GENERATE  uint32 seed; int32 width, height    int32 width, height, width * height tiles
+//
+// The served map is also published in POSIX shared memory (name from
+// OP_INFO): a SharedMapHeader followed by width * height tile bytes, which
+// read-only clients can mmap instead of asking for cells.
+
+const uint32_t MAPD_MAX_FRAME = 1 << 20;
+const size_t MAPD_HEADER_SIZE = 12; // size, id, op/status, count
+
+enum MapdOp
+{
+    OP_INFO = 1,
+    OP_CELL = 2,
+    OP_LOS = 3,
+    OP_FOV = 4,
+    OP_GENERATE = 5
+};
+
+enum MapdStatus
+{
+    STATUS_OK = 0,
+    STATUS_BAD_REQUEST = 1,
+    STATUS_UNKNOWN_OP = 2
+};
+
+const uint32_t SHARED_MAP_MAGIC = 0x4d415044; // "MAPD"
+
+struct SharedMapHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+};
+
+// unaligned reads and writes of the fields
+template <class T>
+inline T readField(const char* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+template <class T>
+inline void appendField(std::string& out, T value)
+{
+    out.append((const char*)&value, sizeof(T));
+}
+
+// starts a frame; finishFrame fills in its size once the payload is appended
+inline size_t beginFrame(std::string& out, uint32_t id, uint16_t opOrStatus, uint16_t count)
+{
+    size_t start = out.size();
+    appendField<uint32_t>(out, 0);
+    appendField<uint32_t>(out, id);
+    appendField<uint16_t>(out, opOrStatus);
+    appendField<uint16_t>(out, count);
+    return start;
+}
+
+inline void finishFrame(std::string& out, size_t start)
+{
+    uint32_t size = (uint32_t)(out.size() - start - sizeof(uint32_t));
+    std::memcpy(&out[start], &size, sizeof(size));
+}
+
+#endif
@@ -2,11 +2,14 @@
 #include <windows.h>
 #include <conio.h>
 #include <vector>
+#include <string>
+#include "platformer.h"
+#include "input.h"
+#include "render_thread.h"
+#include "trace.h"
 
 using namespace std;
-
-const int Width = 70;
-const int Height = 20;
+using namespace platformer;
 
 // function to set cursor position
 void gotoxy(int x, int y) 
@@ -31,97 +34,52 @@ void hideCursor()
 class Game 
 {
     private:
-        vector<string> buffer; // Buffer for the map
-        int playerX; // player x position 
-        int playerY; // player y position
+        Level level; // level, camera and physics
+
         int speed; // player speed
         bool playing; // is the game playing
 
-        // variables for jumping mechanics
-        float jumpVelocity;       // jump velocity
-        bool onGround;             // is the player on the ground?
-        bool canJump;              // can the player keep jumping?
-        int framesJumping;        // how many frames the player has been jumping
+        InputSystem keyboard; // key events read on their own thread
 
-        const float GRAVITY = 0.9f;           // gravity force (increased to fall faster)
-        const float INITIAL_JUMP_IMPULSE = -3.5f;   // initial jump impulse
-        const float MAINTAINED_JUMP_IMPULSE = -0.5f; // impulse while holding the key (reduced)
-        const int MAX_JUMP_FRAMES = 8;        // maximum frames the jump can be maintained (reduced)
+        vector<string> shownRows; // rows currently on the console (render thread only)
+        RenderThread< vector<string> > renderer; // writes the viewport on its own thread
 
     public:
-        // builder
-        Game() 
+        // builder, loads the level from a file or uses the built-in one
+        Game(const string& levelFile = "") 
+            : level(levelFile), renderer([this](const vector<string>& frame) { present(frame); })
         {
             speed = 2; // Initial speed: normal
             playing = true;
-            buffer.resize(Height, string(Width, ' '));
-
-            // Initialize the map with platforms
-            initializeMap();
-
-            // Initial player position
-            playerX = 10;
-            playerY = Height - 2; // Start on the ground
-
-            // Initialize jump variables
-            jumpVelocity = 0;
-            onGround = true;
-            canJump = false;
-            framesJumping = 0;
-        }
-
-        // Initialize the map with platforms
-        void initializeMap() {
-            // Clear the buffer
-            for (int y = 0; y < Height; y++) 
-            {
-                for (int x = 0; x < Width; x++) buffer[y][x] = ' ';
-            }
-            
-            // draw borders
-            for (int x = 0; x < Width; x++) 
-            {
-                buffer[0][x] = '#';           // 
-                buffer[Height - 1][x] = '#';    // floor
-            }
-            for (int y = 0; y < Height; y++) 
-            {
-                buffer[y][0] = '#';           // wall left
-                buffer[y][Width - 1] = '#';   // wall right
-            }
-
-            // Create custom platforms
-            for (int x = 5; x <= 10; x++) buffer[Height - 5][x] = '#';
-            
-            for (int x = 15; x <= 22; x++) buffer[Height - 8][x] = '#';
-            
-            for (int x = 30; x <= 36; x++) buffer[Height - 12][x] = '#';
-            
-            for (int x = 40; x <= 44; x++) buffer[Height - 6][x] = '#';
         }
 
-        // Function to draw the map
+        // Function to draw the map, hands the viewport to the render thread
         void drawMap() {
+            TRACE_SCOPE("drawMap");
+            level.drawMap(renderer.backBuffer());
+            renderer.publish();
+        }
 
-            for (int y = 0; y < Height; y++) {
-                for (int x = 0; x < Width; x++) 
-                {
-                    if (buffer[y][x] == '@') buffer[y][x] = ' ';
-                }
-            }
-
-            // Check if the player's position is valid before drawing
-            if (playerX >= 0 && playerX < Width && playerY >= 0 && playerY < Height) 
+        // Render thread: print only the rows that differ from the console
+        void present(const vector<string>& frame)
+        {
+            TRACE_SCOPE("present");
+            size_t bytesWritten = 0;
+            shownRows.resize(frame.size());
+            for(size_t i=0; i<frame.size(); i++) 
             {
-                buffer[playerY][playerX] = '@';
+                if (shownRows[i] == frame[i]) continue;
+                gotoxy(0, (int)i);
+                cout << frame[i];
+                bytesWritten += frame[i].size();
+                shownRows[i] = frame[i];
             }
+            cout.flush();
+            TRACE_COUNTER("bytes written", bytesWritten);
+        }
 
-            // Print the complete buffer
-            for(int i=0; i<Height; i++) 
-            {
-                gotoxy(0, i);
-                cout << buffer[i];
-            }
+        // Controls shown under the viewport
+        void drawHelp() {
             gotoxy(0, Height);
             cout << "A (izquierda) | D (derecha) | ESPACIO (Saltar)";
             gotoxy(0, Height + 1);
@@ -130,137 +88,42 @@ class Game
             cout << "Presiona ESC para salir                       ";
         }
         
-
-        // Check if there is a solid block (#) at a position
-        bool isSolid(int x, int y) 
-        {
-            if (x < 0 || x >= Width || y < 0 || y >= Height) return true; // Out of bounds is considered solid
-            return buffer[y][x] == '#';
-        }
-        
         // input
         void input() {
+            TRACE_SCOPE("input");
+            // Apply the key events since the last frame
+            keyboard.update();
+
             // Detect Shift (slow) and Ctrl (fast) keys
-            int teclaShift = (GetAsyncKeyState(VK_LSHIFT) & 0x8000) ? 1 : 0;
-            int teclaCtrl = (GetAsyncKeyState(VK_LCONTROL) & 0x8000) ? 1 : 0;
+            int teclaShift = keyboard.isActive(VK_LSHIFT) ? 1 : 0;
+            int teclaCtrl = keyboard.isActive(VK_LCONTROL) ? 1 : 0;
             // calculate speed
             speed = (teclaCtrl - teclaShift) + 2;
             
             // Detect movement keys
-            int teclaA = (GetAsyncKeyState('A') & 0x8000) ? 1 : 0;
-            int teclaD = (GetAsyncKeyState('D') & 0x8000) ? 1 : 0;
+            int teclaA = keyboard.isActive('A') ? 1 : 0;
+            int teclaD = keyboard.isActive('D') ? 1 : 0;
 
             // Calculate movement
             int mov = (teclaD - teclaA) * speed;
 
             // Move player horizontally
-            movplayer(mov);
+            level.movplayer(mov);
             
             // Jump
             Jump();
             
             // gravity
-            Gravity();
+            level.Gravity();
             
             // exit
-            if (GetAsyncKeyState(VK_ESCAPE) & 0x8000) playing = false;
+            if (keyboard.isActive(VK_ESCAPE)) playing = false;
         }
 
         // process jump
         void Jump() {
-            bool spacePressed = GetAsyncKeyState(VK_SPACE) & 0x8000;
-            
-            // start jump
-            if (onGround && spacePressed) 
-            {
-                jumpVelocity = INITIAL_JUMP_IMPULSE;
-                onGround = false;
-                canJump = true;
-                framesJumping = 0;
-            }
-            // extend jump
-            else if (!onGround && spacePressed && canJump) 
-            {
-                framesJumping++;
-
-                // Only apply impulse if going up and haven't exceeded the limit
-                if(jumpVelocity < 0 && framesJumping < MAX_JUMP_FRAMES) 
-                {
-                    jumpVelocity += MAINTAINED_JUMP_IMPULSE;
-                }
-                else canJump = false; // Can't jump anymore
-            }
-            // If space is released, cancel additional impulse
-            else if (!spacePressed && !onGround) canJump = false;
-        }
-
-        // Apply gravity and ground collision
-        void Gravity() {
-            // Apply gravity if not on the ground
-            if (!onGround) 
-            {
-                jumpVelocity += GRAVITY;
-                // Limit maximum falling speed
-                //if (jumpVelocity > 10) jumpVelocity = 10;
-            }
-
-            // If falling
-            if (jumpVelocity > 0) {
-                // Check for ground collision
-                for (int step = 0; step < (int)jumpVelocity; step++) 
-                {
-                    // Check if there is ground in the next position
-                    if (playerY + 1 >= Height || isSolid(playerX, playerY + 1)) 
-                    {
-                        // There is ground below, stop
-                        jumpVelocity = 0;
-                        onGround = true;
-                        return;
-                    }
-                    // Move down one pixel
-                    playerY++;
-                }
-                onGround = false;
-            }
-            // If rising
-            else if (jumpVelocity < 0) 
-            {
-                // Check pixel by pixel upwards
-                int steps = (int)(-jumpVelocity);
-                for (int step = 0; step < steps; step++) 
-                {
-                    // Check if there is a ceiling above
-                    if (playerY - 1 <= 0 || isSolid(playerX, playerY - 1)) 
-                    {
-                        // Hit the ceiling, stop vertical movement
-                        jumpVelocity = 0;
-                        onGround = false;
-                        return;
-                    }
-                    // Move up one pixel
-                    playerY--;
-                }
-                onGround = false;
-            }
-            // If velocity is 0
-            else 
-            {
-                // Check if there is still ground below
-                if (playerY + 1 < Height && !isSolid(playerX, playerY + 1)) onGround = false; 
-                else onGround = true;
-            }
-        }
-
-        // Move player
-        void movplayer(int mov) {
-            if (mov == 0) return; // No movement
-
-            // Calculate new position
-            int newX = playerX + mov;
-
-            // Check for collision with solid blocks
-            if (!isSolid(newX, playerY)) playerX = newX;
-            // If there is a collision, don't move
+            // a tap shorter than a frame still starts the jump
+            level.Jump(keyboard.isActive(VK_SPACE));
         }
 
         // Initialize the game
@@ -268,13 +131,18 @@ class Game
         {
             hideCursor();
             system("cls");
+            drawHelp();
+            keyboard.start();
+            renderer.start();
         }
 
         // Main game loop
         void run() 
         {
+            TRACE_SCOPE("run");
             while (playing) 
             {
+                TRACE_SCOPE("frame");
                 input();
                 drawMap();
                 Sleep(50); // Control game speed
@@ -284,6 +152,9 @@ class Game
         // Finalizar el juego
         void end() 
         {
+            keyboard.stop();
+            renderer.stop();
+            FlushConsoleInputBuffer(GetStdHandle(STD_INPUT_HANDLE));
             system("cls");
             cout << "Game over push any key to continue..." << endl;
             _getch();
@@ -291,13 +162,16 @@ class Game
 };
 
 
-int main() 
+int main(int argc, char* argv[]) 
 {
-    Game game;
+    // optional level file: mapa_movimiento nivel.txt
+    Game game(argc > 1 ? argv[1] : "");
 
     game.start();
     game.run();
     game.end();
 
+    TRACE_EXPORT("mapa_movimiento_trace.json");
+
     return 0;
 }
@@ -0,0 +1,615 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "walk_map.h"
+#include "dungeon.h"
+#include "map_protocol.h"
+#include "trace.h"
+
+using namespace std;
+
+// Map query daemon: loads or generates a map once and answers line-of-sight,
+// FOV, cell and dungeon generation queries over a Unix socket, so other
+// tools don't have to link the map code. See map_protocol.h for the protocol.
+//
+//   g++ -O2 -std=c++17 -pthread mapd.cpp -o mapd
+//   ./mapd                 serves the built-in walk map
+//   ./mapd -d 42           serves a dungeon generated like mapa2 with seed 42
+//   -s path                socket path (default /tmp/mapd.sock)
+//   -m name                shared memory name (default /mapd)
+//   -w count               worker threads (default: one per core)
+//
+// One thread runs the epoll loop: it accepts clients, reads requests and
+// writes responses. Cell and info lookups are answered right there; line of
+// sight, FOV and generation go to the worker pool, each worker with its own
+// copy of the map (visibility keeps per-viewpoint caches).
+
+// Limits per client, so one that sends faster than it reads can't grow the
+// daemon without bound: past them its socket isn't read until the workers
+// and the writes catch up. A client then holds at most about MAX_INPUT +
+// MAX_UNSENT + MAX_QUEUED x (request + response) bytes.
+const int MAX_QUEUED = 16;                          // requests waiting for a worker
+const size_t MAX_UNSENT = 4 << 20;                  // response bytes not written yet
+const size_t MAX_INPUT = MAPD_MAX_FRAME + 65536;    // unparsed request bytes
+
+// client connection, shared between the loop and the workers answering it
+struct Connection
+{
+    int fd;
+    string in;          // unparsed bytes, loop thread only
+    bool finished;      // the client closed its side, loop thread only
+    uint32_t events;    // registered with epoll, loop thread only
+    mutex outLock;
+    string out;         // responses not written yet
+    int queued;         // requests waiting for a worker, under outLock
+    atomic<bool> closed;
+
+    Connection(int socket) : fd(socket), finished(false), events(0), queued(0), closed(false) {}
+};
+
+struct Job
+{
+    shared_ptr<Connection> connection;
+    string frame;
+};
+
+// the served map, written once before the workers start
+vector<string> mapRows;
+int mapWidth = 0, mapHeight = 0;
+string shmName = "/mapd";
+
+mutex generateLock; // dungeon::Map::generate uses rand()
+
+int wakeFd = -1;
+volatile sig_atomic_t stopRequested = 0;
+
+void onSignal(int)
+{
+    stopRequested = 1;
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {} // only wakes the loop up
+}
+
+// Publishes the map in POSIX shared memory for read-only clients
+class SharedMap
+{
+    private:
+        void* memory;
+        size_t size;
+
+    public:
+        SharedMap() : memory(nullptr), size(0) {}
+
+        ~SharedMap()
+        {
+            if (memory)
+            {
+                munmap(memory, size);
+                shm_unlink(shmName.c_str());
+            }
+        }
+
+        bool publish()
+        {
+            size = sizeof(SharedMapHeader) + (size_t)mapWidth * mapHeight;
+            int fd = shm_open(shmName.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+            if (fd < 0) return false;
+            if (ftruncate(fd, size) != 0)
+            {
+                close(fd);
+                return false;
+            }
+            memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (memory == MAP_FAILED)
+            {
+                memory = nullptr;
+                return false;
+            }
+
+            SharedMapHeader header;
+            header.magic = SHARED_MAP_MAGIC;
+            header.version = 1;
+            header.width = mapWidth;
+            header.height = mapHeight;
+            memcpy(memory, &header, sizeof(header));
+            char* cells = (char*)memory + sizeof(SharedMapHeader);
+            for (int y = 0; y < mapHeight; y++) memcpy(cells + (size_t)y * mapWidth, mapRows[y].data(), mapWidth);
+            return true;
+        }
+};
+
+// Builds the response to one request frame. map is null on the loop thread,
+// which only answers the ops that don't need one (see needsWorker).
+void answer(const char* frame, size_t length, walk::Map* map, string& out)
+{
+    TRACE_SCOPE("request");
+    uint32_t id = readField<uint32_t>(frame + 4);
+    uint16_t op = readField<uint16_t>(frame + 8);
+    uint16_t count = readField<uint16_t>(frame + 10);
+    const char* payload = frame + MAPD_HEADER_SIZE;
+    size_t payloadSize = length - MAPD_HEADER_SIZE;
+
+    auto fail = [&](uint16_t status)
+    {
+        size_t start = beginFrame(out, id, status, 0);
+        finishFrame(out, start);
+    };
+
+    switch (op)
+    {
+        case OP_INFO:
+        {
+            size_t start = beginFrame(out, id, STATUS_OK, 1);
+            appendField<int32_t>(out, mapWidth);
+            appendField<int32_t>(out, mapHeight);
+            out += shmName;
+            finishFrame(out, start);
+            break;
+        }
+        case OP_CELL:
+        {
+            if (payloadSize != (size_t)count * 8) return fail(STATUS_BAD_REQUEST);
+            size_t start = beginFrame(out, id, STATUS_OK, count);
+            for (int i = 0; i < count; i++)
+            {
+                int32_t x = readField<int32_t>(payload + i * 8);
+                int32_t y = readField<int32_t>(payload + i * 8 + 4);
+                bool inside = x >= 0 && x < mapWidth && y >= 0 && y < mapHeight;
+                out += inside ? mapRows[y][x] : '#';
+            }
+            finishFrame(out, start);
+            break;
+        }
+        case OP_LOS:
+        {
+            if (payloadSize != (size_t)count * 16) return fail(STATUS_BAD_REQUEST);
+            size_t start = beginFrame(out, id, STATUS_OK, count);
+            for (int i = 0; i < count; i++)
+            {
+                const char* query = payload + i * 16;
+                float x1 = readField<float>(query), y1 = readField<float>(query + 4);
+                int32_t x2 = readField<int32_t>(query + 8), y2 = readField<int32_t>(query + 12);
+                // both ends inside the map, which also bounds the steps
+                bool valid = x1 >= -1 && x1 <= mapWidth && y1 >= -1 && y1 <= mapHeight &&
+                             x2 >= 0 && x2 < mapWidth && y2 >= 0 && y2 < mapHeight;
+                out += (char)(valid && map->hasLineOfSight(x1, y1, x2, y2) ? 1 : 0);
+            }
+            finishFrame(out, start);
+            break;
+        }
+        case OP_FOV:
+        {
+            if (payloadSize != 12) return fail(STATUS_BAD_REQUEST);
+            float x = readField<float>(payload), y = readField<float>(payload + 4), angle = readField<float>(payload + 8);
+            if (!(x >= 0 && x < mapWidth && y >= 0 && y < mapHeight && std::isfinite(angle))) return fail(STATUS_BAD_REQUEST);
+            walk::Player player(x, y);
+            player.rotate(fmod(angle, 360.0f));
+            map->calculateVisibility(player);
+
+            size_t start = beginFrame(out, id, STATUS_OK, 1);
+            size_t bits = out.size();
+            out.append(((size_t)mapWidth * mapHeight + 7) / 8, '\0');
+            for (int cy = 0; cy < mapHeight; cy++)
+            {
+                for (int cx = 0; cx < mapWidth; cx++)
+                {
+                    size_t cell = (size_t)cy * mapWidth + cx;
+                    if (map->isVisible(cx, cy)) out[bits + cell / 8] |= (char)(1 << (cell % 8));
+                }
+            }
+            finishFrame(out, start);
+            break;
+        }
+        case OP_GENERATE:
+        {
+            if (payloadSize != 12) return fail(STATUS_BAD_REQUEST);
+            uint32_t seed = readField<uint32_t>(payload);
+            int32_t width = readField<int32_t>(payload + 4), height = readField<int32_t>(payload + 8);
+            // rooms need some space, the response must stay reasonable
+            if (width < dungeon::Max_Rooms_Size + 4 || height < dungeon::Max_Rooms_Size + 4 ||
+                width > 1024 || height > 1024) return fail(STATUS_BAD_REQUEST);
+
+            vector<string> rows;
+            {
+                lock_guard<mutex> guard(generateLock);
+                srand(seed);
+                dungeon::Map generated(width, height);
+                generated.generate();
+                rows = generated.toRows();
+            }
+            size_t start = beginFrame(out, id, STATUS_OK, 1);
+            appendField<int32_t>(out, width);
+            appendField<int32_t>(out, height);
+            for (const string& row : rows) out += row;
+            finishFrame(out, start);
+            break;
+        }
+        default:
+            fail(STATUS_UNKNOWN_OP);
+    }
+}
+
+bool needsWorker(uint16_t op)
+{
+    return op == OP_LOS || op == OP_FOV || op == OP_GENERATE;
+}
+
+class Daemon
+{
+    private:
+        int epollFd;
+        int listenFd;
+        string socketPath;
+        unordered_map<int, shared_ptr<Connection> > connections;
+
+        // requests for the workers
+        mutex jobLock;
+        condition_variable jobReady;
+        deque<Job> jobs;
+        bool stopping;
+        vector<thread> workers;
+
+        // connections the workers added responses to
+        mutex readyLock;
+        vector<shared_ptr<Connection> > ready;
+
+        void watch(int fd, uint32_t events, int operation)
+        {
+            epoll_event event;
+            event.events = events;
+            event.data.fd = fd;
+            epoll_ctl(epollFd, operation, fd, &event);
+        }
+
+        void workerLoop()
+        {
+            TRACE_THREAD_NAME("worker");
+            walk::Map map(mapRows);
+            string out;
+            while (true)
+            {
+                Job job;
+                {
+                    unique_lock<mutex> lock(jobLock);
+                    jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                    if (jobs.empty()) return;
+                    job = move(jobs.front());
+                    jobs.pop_front();
+                }
+
+                out.clear();
+                answer(job.frame.data(), job.frame.size(), &map, out);
+                {
+                    lock_guard<mutex> guard(job.connection->outLock);
+                    job.connection->out += out;
+                    job.connection->queued--;
+                }
+                {
+                    lock_guard<mutex> guard(readyLock);
+                    ready.push_back(job.connection);
+                }
+                uint64_t one = 1;
+                if (write(wakeFd, &one, sizeof(one)) < 0) {}
+            }
+        }
+
+        void closeConnection(const shared_ptr<Connection>& connection)
+        {
+            if (connection->closed) return;
+            connection->closed = true;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+            close(connection->fd);
+            connections.erase(connection->fd);
+        }
+
+        // writes what the socket takes; false when the connection failed and was closed
+        bool flush(const shared_ptr<Connection>& connection)
+        {
+            bool failed = false;
+            {
+                lock_guard<mutex> guard(connection->outLock);
+                size_t written = 0;
+                while (written < connection->out.size())
+                {
+                    ssize_t n = send(connection->fd, connection->out.data() + written,
+                                     connection->out.size() - written, MSG_NOSIGNAL);
+                    if (n > 0) written += n;
+                    else if (n < 0 && errno == EINTR) continue;
+                    else
+                    {
+                        failed = n < 0 && errno != EAGAIN;
+                        break;
+                    }
+                }
+                connection->out.erase(0, written);
+            }
+            if (failed) closeConnection(connection);
+            return !failed;
+        }
+
+        void accept()
+        {
+            while (true)
+            {
+                int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+                shared_ptr<Connection> connection = make_shared<Connection>(fd);
+                connection->events = EPOLLIN | EPOLLRDHUP;
+                connections[fd] = connection;
+                watch(fd, connection->events, EPOLL_CTL_ADD);
+            }
+        }
+
+        // reads what is available up to MAX_INPUT; the requests are dispatched by service
+        void receive(const shared_ptr<Connection>& connection)
+        {
+            char buffer[65536];
+            while (connection->in.size() < MAX_INPUT)
+            {
+                ssize_t n = read(connection->fd, buffer, sizeof(buffer));
+                if (n > 0) connection->in.append(buffer, n);
+                else if (n < 0 && errno == EINTR) continue;
+                else if (n == 0) connection->finished = true;
+                else if (errno != EAGAIN) closeConnection(connection);
+                if (n <= 0) return;
+            }
+        }
+
+        bool overloaded(const shared_ptr<Connection>& connection)
+        {
+            lock_guard<mutex> guard(connection->outLock);
+            return connection->queued >= MAX_QUEUED || connection->out.size() >= MAX_UNSENT;
+        }
+
+        // answers or queues the complete requests while the client is under
+        // its limits; false on a protocol error
+        bool dispatch(const shared_ptr<Connection>& connection)
+        {
+            string& in = connection->in;
+            size_t offset = 0;
+            while (in.size() - offset >= sizeof(uint32_t) && !overloaded(connection))
+            {
+                uint32_t size = readField<uint32_t>(in.data() + offset);
+                if (size < MAPD_HEADER_SIZE - sizeof(uint32_t) || size > MAPD_MAX_FRAME)
+                {
+                    // not speaking the protocol
+                    closeConnection(connection);
+                    return false;
+                }
+                size_t length = sizeof(uint32_t) + size;
+                if (in.size() - offset < length) break;
+
+                const char* frame = in.data() + offset;
+                if (needsWorker(readField<uint16_t>(frame + 8)))
+                {
+                    {
+                        lock_guard<mutex> guard(connection->outLock);
+                        connection->queued++;
+                    }
+                    lock_guard<mutex> guard(jobLock);
+                    jobs.push_back(Job{ connection, string(frame, length) });
+                    jobReady.notify_one();
+                }
+                else
+                {
+                    lock_guard<mutex> guard(connection->outLock);
+                    answer(frame, length, nullptr, connection->out);
+                }
+                offset += length;
+            }
+            in.erase(0, offset);
+            return true;
+        }
+
+        // After anything happened to a connection: dispatches its requests,
+        // writes its responses and updates what epoll waits for. A client
+        // that closed its side gets every answer before the socket closes.
+        void service(const shared_ptr<Connection>& connection)
+        {
+            if (connection->closed || !dispatch(connection) || !flush(connection)) return;
+
+            size_t unsent;
+            int queued;
+            {
+                lock_guard<mutex> guard(connection->outLock);
+                unsent = connection->out.size();
+                queued = connection->queued;
+            }
+            if (connection->finished && !unsent && queued == 0)
+            {
+                closeConnection(connection);
+                return;
+            }
+
+            // reading pauses while the client is over a limit; EPOLLIN and
+            // EPOLLRDHUP stay set after the end of the input, so they are
+            // dropped then instead of reporting it again and again
+            bool reading = !connection->finished && queued < MAX_QUEUED && unsent < MAX_UNSENT &&
+                           connection->in.size() < MAX_INPUT;
+            uint32_t events = (reading ? (uint32_t)(EPOLLIN | EPOLLRDHUP) : 0u) | (unsent ? (uint32_t)EPOLLOUT : 0u);
+            if (events != connection->events)
+            {
+                connection->events = events;
+                watch(connection->fd, events, EPOLL_CTL_MOD);
+            }
+        }
+
+    public:
+        Daemon() : epollFd(-1), listenFd(-1), stopping(false) {}
+
+        ~Daemon()
+        {
+            {
+                lock_guard<mutex> guard(jobLock);
+                stopping = true;
+            }
+            jobReady.notify_all();
+            for (thread& worker : workers) worker.join();
+            for (auto& entry : connections) close(entry.first);
+            if (listenFd >= 0)
+            {
+                close(listenFd);
+                unlink(socketPath.c_str());
+            }
+            if (epollFd >= 0) close(epollFd);
+        }
+
+        bool start(const string& path, int workerCount)
+        {
+            socketPath = path;
+            sockaddr_un address;
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(address.sun_path)) return false;
+            strcpy(address.sun_path, path.c_str());
+
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd < 0) return false;
+            unlink(path.c_str());
+            if (bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 128) != 0) return false;
+
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd < 0) return false;
+            watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+            watch(wakeFd, EPOLLIN, EPOLL_CTL_ADD);
+
+            for (int i = 0; i < workerCount; i++) workers.push_back(thread(&Daemon::workerLoop, this));
+            return true;
+        }
+
+        void run()
+        {
+            epoll_event events[64];
+            while (!stopRequested)
+            {
+                int count = epoll_wait(epollFd, events, 64, -1);
+                if (count < 0 && errno != EINTR) break;
+                for (int i = 0; i < count; i++)
+                {
+                    int fd = events[i].data.fd;
+                    if (fd == listenFd)
+                    {
+                        accept();
+                    }
+                    else if (fd == wakeFd)
+                    {
+                        uint64_t value;
+                        if (read(wakeFd, &value, sizeof(value)) < 0) {}
+                        vector<shared_ptr<Connection> > answered;
+                        {
+                            lock_guard<mutex> guard(readyLock);
+                            answered.swap(ready);
+                        }
+                        for (const shared_ptr<Connection>& connection : answered) service(connection);
+                    }
+                    else
+                    {
+                        auto found = connections.find(fd);
+                        if (found == connections.end()) continue;
+                        shared_ptr<Connection> connection = found->second;
+                        if (events[i].events & (EPOLLHUP | EPOLLERR))
+                        {
+                            // both directions are gone, the answers can't be delivered
+                            closeConnection(connection);
+                            continue;
+                        }
+                        if (events[i].events & (EPOLLIN | EPOLLRDHUP)) receive(connection);
+                        service(connection);
+                    }
+                }
+            }
+        }
+};
+
+int main(int argc, char* argv[])
+{
+    string socketPath = "/tmp/mapd.sock";
+    int workerCount = max(1, (int)thread::hardware_concurrency());
+    bool generate = false;
+    unsigned seed = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (option == "-d")
+        {
+            generate = true;
+            seed = hasValue && argv[i + 1][0] != '-' ? (unsigned)atoi(argv[++i]) : (unsigned)time(0);
+        }
+        else if (option == "-s" && hasValue) socketPath = argv[++i];
+        else if (option == "-m" && hasValue) shmName = argv[++i];
+        else if (option == "-w" && hasValue) workerCount = max(1, atoi(argv[++i]));
+        else
+        {
+            cerr << "usage: mapd [-d seed] [-s socket] [-m shm_name] [-w workers]" << endl;
+            return 1;
+        }
+    }
+
+    // the map, from the dungeon generator or the built-in walk map
+    if (generate)
+    {
+        srand(seed);
+        dungeon::Map generated;
+        generated.generate();
+        mapRows = generated.toRows();
+    }
+    else
+    {
+        walk::Map builtIn;
+        for (int y = 0; y < builtIn.height(); y++)
+        {
+            string row;
+            for (int x = 0; x < builtIn.width(); x++) row += builtIn.getCell(x, y);
+            mapRows.push_back(row);
+        }
+    }
+    mapHeight = (int)mapRows.size();
+    mapWidth = mapHeight > 0 ? (int)mapRows[0].size() : 0;
+
+    SharedMap shared;
+    if (!shared.publish()) cerr << "mapd: shared memory " << shmName << " not available: " << strerror(errno) << endl;
+
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    {
+        Daemon daemon;
+        if (!daemon.start(socketPath, workerCount))
+        {
+            cerr << "mapd: can't listen on " << socketPath << ": " << strerror(errno) << endl;
+            return 1;
+        }
+        cerr << "mapd: " << mapWidth << "x" << mapHeight << " map on " << socketPath
+             << ", shared memory " << shmName << ", " << workerCount << " workers" << endl;
+        daemon.run();
+    }
+
+    close(wakeFd);
+    TRACE_EXPORT("mapd_trace.json");
+    return 0;
+}
@@ -0,0 +1,209 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Jump and gravity kernel for the platformer.
+// Velocities are fixed point (thousandths of a cell) so every compiler and CPU
+// produces the same results and the tuning constants are exact. Bodies are
+// stored as parallel arrays so a whole batch is stepped per call (the
+// integration steps four bodies per instruction with SSE2).
+
+typedef int32_t fixed;
+
+const fixed FIXED_ONE = 1000;
+
+// converts a constant to fixed point (rounded), usable as a template argument
+constexpr fixed toFixed(double value)
+{
+    return (fixed)(value * FIXED_ONE + (value < 0 ? -0.5 : 0.5));
+}
+
+// whole cells of a fixed point value, truncated towards zero like (int)float
+inline int fixedToInt(fixed value)
+{
+    return value / FIXED_ONE;
+}
+
+// tuning profile, every combination gets its own specialized kernel
+template <fixed Gravity, fixed InitialImpulse, fixed MaintainedImpulse, int MaxJumpFrames>
+struct JumpProfile
+{
+    static constexpr fixed GRAVITY = Gravity;                       // added every frame while in the air
+    static constexpr fixed INITIAL_JUMP_IMPULSE = InitialImpulse;    // velocity when the jump starts
+    static constexpr fixed MAINTAINED_JUMP_IMPULSE = MaintainedImpulse; // added while the key is held
+    static constexpr int MAX_JUMP_FRAMES = MaxJumpFrames;           // frames the jump can be maintained
+};
+
+// bodies as parallel arrays (flags are 0 or 1)
+struct BodyArray
+{
+    std::vector<int32_t> x;             // cell column
+    std::vector<int32_t> y;             // cell row
+    std::vector<fixed> velocity;        // vertical velocity, positive goes down
+    std::vector<int32_t> onGround;      // is the body on the ground?
+    std::vector<int32_t> canJump;       // can the body keep jumping?
+    std::vector<int32_t> framesJumping; // how many frames the body has been jumping
+    std::vector<int32_t> jumpHeld;      // input: is the jump key held this frame?
+
+    int size() const { return (int)x.size(); }
+
+    // adds a body standing on the ground, returns its index
+    int add(int startX, int startY)
+    {
+        x.push_back(startX);
+        y.push_back(startY);
+        velocity.push_back(0);
+        onGround.push_back(1);
+        canJump.push_back(0);
+        framesJumping.push_back(0);
+        jumpHeld.push_back(0);
+        return size() - 1;
+    }
+};
+
+// Jump input and gravity for bodies [first, last).
+// Same rules as the original per-player code, written as selects: four
+// bodies per iteration with SSE2 (flags become 0 / -1 masks), the rest one
+// at a time.
+template <class Profile>
+void integrateBodies(BodyArray& bodies, int first, int last)
+{
+    fixed* velocity = bodies.velocity.data();
+    int32_t* onGround = bodies.onGround.data();
+    int32_t* canJump = bodies.canJump.data();
+    int32_t* framesJumping = bodies.framesJumping.data();
+    const int32_t* jumpHeld = bodies.jumpHeld.data();
+
+    int i = first;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi32(-1);
+    const __m128i initialImpulse = _mm_set1_epi32(Profile::INITIAL_JUMP_IMPULSE);
+    const __m128i maintainedImpulse = _mm_set1_epi32(Profile::MAINTAINED_JUMP_IMPULSE);
+    const __m128i gravity = _mm_set1_epi32(Profile::GRAVITY);
+    const __m128i maxFrames = _mm_set1_epi32(Profile::MAX_JUMP_FRAMES);
+    for (; i + 4 <= last; i += 4)
+    {
+        __m128i ground = _mm_sub_epi32(zero, _mm_loadu_si128((const __m128i*)(onGround + i)));
+        __m128i held = _mm_sub_epi32(zero, _mm_loadu_si128((const __m128i*)(jumpHeld + i)));
+        __m128i can = _mm_sub_epi32(zero, _mm_loadu_si128((const __m128i*)(canJump + i)));
+        __m128i v = _mm_loadu_si128((const __m128i*)(velocity + i));
+
+        __m128i start = _mm_and_si128(ground, held);
+        __m128i extend = _mm_andnot_si128(ground, _mm_and_si128(held, can));
+        // frames + 1 while extending, 0 on a new jump
+        __m128i frames = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(framesJumping + i)), extend);
+        frames = _mm_andnot_si128(start, frames);
+        __m128i boost = _mm_and_si128(extend, _mm_and_si128(_mm_cmplt_epi32(v, zero), _mm_cmplt_epi32(frames, maxFrames)));
+        __m128i cancel = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(ground, held), ones), _mm_andnot_si128(boost, extend));
+
+        v = _mm_add_epi32(v, _mm_and_si128(boost, maintainedImpulse));
+        v = _mm_or_si128(_mm_and_si128(start, initialImpulse), _mm_andnot_si128(start, v));
+        ground = _mm_andnot_si128(start, ground);
+        v = _mm_add_epi32(v, _mm_andnot_si128(ground, gravity));
+
+        _mm_storeu_si128((__m128i*)(velocity + i), v);
+        _mm_storeu_si128((__m128i*)(onGround + i), _mm_srli_epi32(ground, 31));
+        _mm_storeu_si128((__m128i*)(canJump + i), _mm_srli_epi32(_mm_or_si128(start, _mm_andnot_si128(cancel, can)), 31));
+        _mm_storeu_si128((__m128i*)(framesJumping + i), frames);
+    }
+#endif
+    for (; i < last; i++)
+    {
+        int32_t ground = onGround[i];
+        int32_t held = jumpHeld[i];
+        int32_t can = canJump[i];
+        fixed v = velocity[i];
+
+        // start jump
+        int32_t start = ground & held;
+        // extend jump
+        int32_t extend = (ground ^ 1) & held & can;
+        int32_t frames = start ? 0 : framesJumping[i] + extend;
+        // only apply impulse if going up and haven't exceeded the limit
+        int32_t boost = extend & (int32_t)(v < 0) & (int32_t)(frames < Profile::MAX_JUMP_FRAMES);
+        // releasing the key, or running out of boost, cancels additional impulse
+        int32_t cancel = ((ground ^ 1) & (held ^ 1)) | (extend & (boost ^ 1));
+
+        v = start ? Profile::INITIAL_JUMP_IMPULSE : v + boost * Profile::MAINTAINED_JUMP_IMPULSE;
+        ground &= start ^ 1;
+        // apply gravity if not on the ground
+        v += (ground ^ 1) * Profile::GRAVITY;
+
+        velocity[i] = v;
+        onGround[i] = ground;
+        canJump[i] = start | (can & (cancel ^ 1));
+        framesJumping[i] = frames;
+    }
+}
+
+// Moves bodies [first, last) cell by cell and resolves ground and ceiling
+// collisions. isSolid(x, y) must treat out of bounds as solid.
+template <class SolidFn>
+void resolveBodies(BodyArray& bodies, int first, int last, int levelHeight, SolidFn isSolid)
+{
+    for (int i = first; i < last; i++)
+    {
+        int x = bodies.x[i];
+        int y = bodies.y[i];
+        fixed v = bodies.velocity[i];
+
+        // If falling
+        if (v > 0)
+        {
+            int steps = fixedToInt(v);
+            bodies.onGround[i] = 0;
+            for (int step = 0; step < steps; step++)
+            {
+                // There is ground below, stop
+                if (y + 1 >= levelHeight || isSolid(x, y + 1))
+                {
+                    v = 0;
+                    bodies.onGround[i] = 1;
+                    break;
+                }
+                y++;
+            }
+        }
+        // If rising
+        else if (v < 0)
+        {
+            int steps = fixedToInt(-v);
+            bodies.onGround[i] = 0;
+            for (int step = 0; step < steps; step++)
+            {
+                // Hit the ceiling, stop vertical movement
+                if (y - 1 <= 0 || isSolid(x, y - 1))
+                {
+                    v = 0;
+                    break;
+                }
+                y--;
+            }
+        }
+        // If velocity is 0, check if there is still ground below
+        else
+        {
+            bodies.onGround[i] = (y + 1 >= levelHeight || isSolid(x, y + 1)) ? 1 : 0;
+        }
+
+        bodies.y[i] = y;
+        bodies.velocity[i] = v;
+    }
+}
+
+// One physics tick for every body
+template <class Profile, class SolidFn>
+void stepBodies(BodyArray& bodies, int levelHeight, SolidFn isSolid)
+{
+    integrateBodies<Profile>(bodies, 0, bodies.size());
+    resolveBodies(bodies, 0, bodies.size(), levelHeight, isSolid);
+}
+
+#endif
@@ -0,0 +1,354 @@
+#ifndef PLATFORMER_H
+#define PLATFORMER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include "physics.h"
+#include "grid.h"
+#include "level_art.h"
+#include "map_changes.h"
+
+// Level, camera and physics of mapa_movimiento.cpp, without any console
+// code so it can be built and benchmarked on any platform
+namespace platformer
+{
+
+// viewport (console) dimensions, the level itself can be much larger
+const int Width = 70;
+const int Height = 20;
+
+// built-in level, baked at compile time; '@' is the player start
+constexpr char builtInArt[] = R"(
+######################################################################
+#                                                                    #
+#                                                                    #
+#                                                                    #
+#                                                                    #
+#                                                                    #
+#                                                                    #
+#                                                                    #
+#                             #######                                #
+#                                                                    #
+#                                                                    #
+#                                                                    #
+#              ########                                              #
+#                                                                    #
+#                                       #####                        #
+#    ######                                                          #
+#                                                                    #
+#                                                                    #
+#         @                                                          #
+######################################################################)";
+
+constexpr auto builtInLevel = bakeLevel<builtInArt, '#', ' '>();
+static_assert(builtInLevel.width == Width && builtInLevel.height == Height, "the built-in level must fill the viewport");
+static_assert(builtInLevel.startX >= 0 && builtInLevel.solid(builtInLevel.startX, builtInLevel.startY + 1),
+              "the player must start on the ground");
+
+class Level
+{
+    private:
+        Grid<char> buffer; // Buffer for the level (without the player), outside it is solid
+
+        // collision bitmask of buffer: bit x % 64 of word x / 64 of a row is
+        // set for a solid cell. The built-in level copies the baked one,
+        // setCell keeps it current.
+        std::vector<uint64_t> solid;
+        int solidWords; // words per row
+
+        std::vector<std::string> screen; // Viewport already composited
+        int cameraX; // level column shown at the left edge of the viewport
+        int cameraY; // level row shown at the top edge of the viewport
+        bool screenValid; // false until the viewport has been composited once
+        int drawnPlayerX; // viewport position where the player was last drawn
+        int drawnPlayerY;
+
+        // jumping mechanics: gravity force (increased to fall faster), initial jump impulse,
+        // impulse while holding the key (reduced) and maximum frames the jump can be maintained (reduced)
+        typedef JumpProfile<toFixed(0.9), toFixed(-3.5), toFixed(-0.5), 8> Physics;
+
+        BodyArray bodies; // every body simulated by the physics kernel
+        int player;       // index of the player in bodies
+
+        ChangeTracker changes;
+
+        void setSolid(int x, int y, bool wall)
+        {
+            uint64_t& word = solid[(size_t)y * solidWords + x / 64];
+            if (wall) word |= 1ULL << (x % 64);
+            else word &= ~(1ULL << (x % 64));
+        }
+
+        // viewport columns showing a changed region are copied again
+        void applyChanges()
+        {
+            for (const CellRect& r : changes.take())
+            {
+                int fromX = std::max(r.x0 - cameraX, 0);
+                int toX = std::min(r.x1 - cameraX, Width);
+                bool onScreen = r.y0 < cameraY + Height && r.y1 > cameraY;
+                if (screenValid && onScreen && fromX < toX) composeColumns(fromX, toX);
+                changes.notify(r);
+            }
+        }
+
+    public:
+        // builder, loads the level from a file or uses the built-in one
+        Level(const std::string& levelFile = "")
+        {
+            // Initial player position
+            int playerX = builtInLevel.startX;
+            int playerY = builtInLevel.startY;
+
+            // Load the level or initialize the map with platforms
+            if (levelFile.empty() || !loadLevel(levelFile, playerX, playerY)) initializeMap();
+
+            start(playerX, playerY);
+        }
+
+        // builder, level from text rows
+        Level(const std::vector<std::string>& rows)
+        {
+            // Initial player position
+            int playerX = builtInLevel.startX;
+            int playerY = builtInLevel.startY;
+
+            if (!loadRows(rows, playerX, playerY)) initializeMap();
+
+            start(playerX, playerY);
+        }
+
+        // Load a level from a text file, '#' is solid and '@' marks the player start
+        bool loadLevel(const std::string& path, int& playerX, int& playerY)
+        {
+            std::ifstream file(path);
+            if (!file) return false;
+
+            std::vector<std::string> rows;
+            std::string line;
+            while (std::getline(file, line))
+            {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                rows.push_back(line);
+            }
+            return loadRows(rows, playerX, playerY);
+        }
+
+        // Load a level from text rows, same format as the files. Without an
+        // '@' the player starts on the first cell with ground under it.
+        bool loadRows(std::vector<std::string> rows, int& playerX, int& playerY)
+        {
+            size_t widest = 0;
+            for (const std::string& row : rows) widest = std::max(widest, row.size());
+            if (rows.empty() || widest == 0) return false;
+
+            // pad every row to the same width
+            for (std::string& row : rows) row.resize(widest, ' ');
+
+            // player start
+            int startX = -1, startY = -1;
+            for (int y = 0; y < (int)rows.size(); y++)
+            {
+                size_t x = rows[y].find('@');
+                if (x != std::string::npos)
+                {
+                    startX = (int)x;
+                    startY = y;
+                    rows[y][x] = ' ';
+                }
+            }
+            // without '@' the first empty cell standing on something solid
+            // (the bottom of the level counts as solid)
+            for (int y = 0; y < (int)rows.size() && startX < 0; y++)
+            {
+                for (int x = 0; x < (int)widest && startX < 0; x++)
+                {
+                    bool ground = y + 1 == (int)rows.size() || rows[y + 1][x] == '#';
+                    if (rows[y][x] != '#' && ground)
+                    {
+                        startX = x;
+                        startY = y;
+                    }
+                }
+            }
+            if (startX < 0) return false; // nowhere to stand
+            playerX = startX;
+            playerY = startY;
+
+            buffer = Grid<char>((int)widest, (int)rows.size(), ' ', '#');
+            for (int y = 0; y < buffer.height(); y++) std::copy(rows[y].begin(), rows[y].end(), buffer.row(y));
+
+            solidWords = (buffer.width() + 63) / 64;
+            solid.assign((size_t)buffer.height() * solidWords, 0);
+            for (int y = 0; y < buffer.height(); y++)
+                for (int x = 0; x < buffer.width(); x++) setSolid(x, y, buffer.at(x, y) == '#');
+            return true;
+        }
+
+        // Initialize the map with platforms
+        void initializeMap() {
+            buffer = Grid<char>(Width, Height, ' ', '#');
+            builtInLevel.copyTo(buffer);
+            solidWords = builtInLevel.wordsPerRow;
+            solid.assign(&builtInLevel.walls[0][0], &builtInLevel.walls[0][0] + Height * solidWords);
+        }
+
+        // The player starts on the ground with the jump variables cleared
+        void start(int playerX, int playerY)
+        {
+            bodies = BodyArray();
+            player = bodies.add(playerX, playerY);
+
+            // Viewport
+            screen.assign(Height, std::string(Width, ' '));
+            cameraX = 0;
+            cameraY = 0;
+            screenValid = false;
+            drawnPlayerX = -1;
+            drawnPlayerY = -1;
+        }
+
+        int width() const { return buffer.width(); }
+        int height() const { return buffer.height(); }
+        int playerX() const { return bodies.x[player]; }
+        int playerY() const { return bodies.y[player]; }
+
+        // Level cell as seen by the viewport, outside the level is empty
+        char levelCell(int x, int y) const
+        {
+            if (!buffer.inside(x, y)) return ' ';
+            return buffer.at(x, y);
+        }
+
+        // Copy level columns [fromX, toX) of the viewport from the level
+        void composeColumns(int fromX, int toX)
+        {
+            for (int y = 0; y < Height; y++)
+            {
+                // part of the columns that falls inside the level
+                int levelY = cameraY + y;
+                int first = std::max(fromX, -cameraX);
+                int last = std::min(toX, buffer.width() - cameraX);
+                if (levelY < 0 || levelY >= buffer.height() || first >= last)
+                {
+                    std::fill(screen[y].begin() + fromX, screen[y].begin() + toX, ' ');
+                    continue;
+                }
+                std::fill(screen[y].begin() + fromX, screen[y].begin() + first, ' ');
+                const char* row = buffer.row(levelY) + cameraX;
+                std::copy(row + first, row + last, screen[y].begin() + first);
+                std::fill(screen[y].begin() + last, screen[y].begin() + toX, ' ');
+            }
+        }
+
+        // Keep the player inside the viewport, centered horizontally
+        void updateCamera()
+        {
+            int newCameraX = bodies.x[player] - Width / 2;
+            newCameraX = std::max(0, std::min(newCameraX, buffer.width() - Width));
+            int newCameraY = bodies.y[player] - Height / 2;
+            newCameraY = std::max(0, std::min(newCameraY, buffer.height() - Height));
+
+            // restore the cell under the player before moving anything
+            if (screenValid && drawnPlayerX >= 0)
+            {
+                screen[drawnPlayerY][drawnPlayerX] = levelCell(cameraX + drawnPlayerX, cameraY + drawnPlayerY);
+            }
+            drawnPlayerX = -1;
+
+            int dx = newCameraX - cameraX;
+            if (!screenValid || newCameraY != cameraY || std::abs(dx) >= Width)
+            {
+                // full recomposition
+                cameraX = newCameraX;
+                cameraY = newCameraY;
+                composeColumns(0, Width);
+                screenValid = true;
+            }
+            else if (dx > 0)
+            {
+                // scroll right: shift left and fill the new columns on the right
+                for (int y = 0; y < Height; y++) std::copy(screen[y].begin() + dx, screen[y].end(), screen[y].begin());
+                cameraX = newCameraX;
+                composeColumns(Width - dx, Width);
+            }
+            else if (dx < 0)
+            {
+                // scroll left: shift right and fill the new columns on the left
+                for (int y = 0; y < Height; y++) std::copy_backward(screen[y].begin(), screen[y].end() + dx, screen[y].end());
+                cameraX = newCameraX;
+                composeColumns(0, -dx);
+            }
+        }
+
+        // Function to draw the map: composites the viewport into frame
+        void drawMap(std::vector<std::string>& frame) {
+
+            updateCamera();
+
+            // Check if the player's position is valid before drawing
+            int sx = bodies.x[player] - cameraX;
+            int sy = bodies.y[player] - cameraY;
+            if (sx >= 0 && sx < Width && sy >= 0 && sy < Height)
+            {
+                screen[sy][sx] = '@';
+                drawnPlayerX = sx;
+                drawnPlayerY = sy;
+            }
+
+            frame = screen;
+        }
+
+        // Changes a level cell during play ('#' solid, ' ' empty). Outside a
+        // batch the viewport and the listeners are updated right away.
+        void setCell(int x, int y, char value)
+        {
+            if (!buffer.inside(x, y) || buffer.at(x, y) == value) return;
+            buffer.at(x, y) = value;
+            setSolid(x, y, value == '#');
+            changes.add(x, y);
+            if (!changes.batching()) applyChanges();
+        }
+
+        void beginChanges() { changes.begin(); }
+        void endChanges() { if (changes.end()) applyChanges(); }
+
+        int subscribe(ChangeTracker::Listener listener) { return changes.subscribe(listener); }
+        void unsubscribe(int id) { changes.unsubscribe(id); }
+
+        // Check if there is a solid block (#) at a position
+        bool isSolid(int x, int y) const
+        {
+            if (!buffer.inside(x, y)) return true; // Out of bounds is considered solid
+            return (solid[(size_t)y * solidWords + x / 64] >> (x % 64)) & 1;
+        }
+
+        // process jump, the kernel starts, extends or cancels it
+        void Jump(bool spacePressed) {
+            bodies.jumpHeld[player] = spacePressed ? 1 : 0;
+        }
+
+        // Apply gravity and ground collision
+        void Gravity() {
+            stepBodies<Physics>(bodies, buffer.height(), [this](int x, int y) { return isSolid(x, y); });
+        }
+
+        // Move player
+        void movplayer(int mov) {
+            if (mov == 0) return; // No movement
+
+            // Calculate new position
+            int newX = bodies.x[player] + mov;
+
+            // Check for collision with solid blocks
+            if (!isSolid(newX, bodies.y[player])) bodies.x[player] = newX;
+            // If there is a collision, don't move
+        }
+};
+
+} // namespace platformer
+
+#endif
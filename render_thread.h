@@ -0,0 +1,99 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include "trace.h"
+
+// Lock-free triple buffer: one producer writes the back buffer and publishes
+// it, one consumer takes the most recent published frame. Frames published
+// while the consumer is busy replace each other, so stale frames are dropped.
+template <class Frame>
+class TripleBuffer
+{
+    private:
+        static const int NEW_FRAME = 4; // set in middle when it holds an unread frame
+
+        Frame buffers[3];
+        int back;                // producer owned
+        std::atomic<int> middle; // shared: index | NEW_FRAME
+        int front;               // consumer owned
+
+    public:
+        TripleBuffer() : back(0), middle(1), front(2) {}
+
+        // producer: frame being built
+        Frame& backBuffer() { return buffers[back]; }
+
+        // producer: hands the back buffer over and gets a free one
+        void publish()
+        {
+            back = middle.exchange(back | NEW_FRAME, std::memory_order_acq_rel) & 3;
+        }
+
+        // consumer: takes the newest frame, false if nothing new was published
+        bool acquire()
+        {
+            if (!(middle.load(std::memory_order_relaxed) & NEW_FRAME)) return false;
+            front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+            return true;
+        }
+
+        // consumer: frame taken by the last acquire
+        const Frame& frontBuffer() const { return buffers[front]; }
+};
+
+// Thread that writes frames to the terminal.
+// The game thread builds a frame in backBuffer() and calls publish(), which
+// never blocks; the render thread presents only the newest frame, so a slow
+// terminal drops frames instead of slowing down the simulation.
+template <class Frame>
+class RenderThread
+{
+    private:
+        TripleBuffer<Frame> frames;
+        std::function<void(const Frame&)> present;
+        std::thread renderer;
+        std::atomic<bool> running;
+
+        void renderLoop()
+        {
+            TRACE_THREAD_NAME("render");
+            while (running.load(std::memory_order_relaxed))
+            {
+                if (frames.acquire()) present(frames.frontBuffer());
+                else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            // show the last frame before leaving
+            if (frames.acquire()) present(frames.frontBuffer());
+        }
+
+    public:
+        RenderThread(std::function<void(const Frame&)> presentFrame) : present(presentFrame), running(false) {}
+
+        ~RenderThread()
+        {
+            stop();
+        }
+
+        void start()
+        {
+            if (running) return;
+            running = true;
+            renderer = std::thread(&RenderThread::renderLoop, this);
+        }
+
+        // waits until the last published frame is on screen
+        void stop()
+        {
+            running = false;
+            if (renderer.joinable()) renderer.join();
+        }
+
+        Frame& backBuffer() { return frames.backBuffer(); }
+        void publish() { frames.publish(); }
+};
+
+#endif
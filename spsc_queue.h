@@ -0,0 +1,51 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity must be a power of two; push fails instead of blocking when full.
+template <class T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    private:
+        T items[Capacity];
+        alignas(64) std::atomic<size_t> head; // next slot to read, written by the consumer
+        alignas(64) std::atomic<size_t> tail; // next slot to write, written by the producer
+
+    public:
+        SpscQueue() : head(0), tail(0) {}
+
+        // producer side
+        bool push(const T& item)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == Capacity) return false; // full
+            items[t & (Capacity - 1)] = item;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side
+        bool pop(T& item)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false; // empty
+            item = items[h & (Capacity - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer side, looks at the next item without removing it
+        const T* peek() const
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return nullptr;
+            return &items[h & (Capacity - 1)];
+        }
+};
+
+#endif
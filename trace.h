@@ -0,0 +1,175 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped timers and counters exported as Chrome / Perfetto trace JSON.
+// Everything compiles to nothing unless TRACING is defined:
+//
+//   g++ -DTRACING -O2 -std=c++17 -pthread walk.cpp -o walk
+//
+//   TRACE_SCOPE("calculateVisibility");    time until the end of the block
+//   TRACE_COUNTER("rays cast", rays);      value shown as a counter track
+//   TRACE_THREAD_NAME("render");           label for the current thread
+//   TRACE_EXPORT("walk_trace.json");       write every event, call at exit
+//
+// Each thread writes into its own ring buffer (the newest TRACE_CAPACITY
+// events are kept), so recording takes no lock; a scope costs two clock reads
+// and one store. Names must be string literals.
+
+#ifdef TRACING
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+const size_t TRACE_CAPACITY = 1 << 16; // events per thread
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t time;  // start, nanoseconds
+    uint64_t value; // duration for scopes, value for counters
+    char phase;     // 'X' scope, 'C' counter
+};
+
+struct TraceBuffer
+{
+    int thread;
+    const char* threadName;
+    uint64_t count; // events ever written, the ring holds the last TRACE_CAPACITY
+    std::vector<TraceEvent> events;
+
+    TraceBuffer(int id) : thread(id), threadName(nullptr), count(0), events(TRACE_CAPACITY) {}
+
+    void write(const char* name, uint64_t time, uint64_t value, char phase)
+    {
+        TraceEvent& event = events[count % TRACE_CAPACITY];
+        event.name = name;
+        event.time = time;
+        event.value = value;
+        event.phase = phase;
+        count++;
+    }
+};
+
+// buffers of every thread, kept until the program exits so events of
+// finished threads can still be exported
+struct TraceRegistry
+{
+    std::mutex lock;
+    std::vector<TraceBuffer*> buffers;
+
+    static TraceRegistry& instance()
+    {
+        static TraceRegistry registry;
+        return registry;
+    }
+};
+
+inline uint64_t traceNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// buffer of the calling thread, registered on first use
+inline TraceBuffer& traceBuffer()
+{
+    thread_local TraceBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        TraceRegistry& registry = TraceRegistry::instance();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        buffer = new TraceBuffer((int)registry.buffers.size() + 1);
+        registry.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+class TraceScope
+{
+    private:
+        const char* name;
+        uint64_t start;
+
+    public:
+        TraceScope(const char* scopeName) : name(scopeName), start(traceNow()) {}
+
+        ~TraceScope()
+        {
+            uint64_t end = traceNow();
+            traceBuffer().write(name, start, end - start, 'X');
+        }
+};
+
+inline void traceCounter(const char* name, uint64_t value)
+{
+    traceBuffer().write(name, traceNow(), value, 'C');
+}
+
+inline void traceThreadName(const char* name)
+{
+    traceBuffer().threadName = name;
+}
+
+// writes every recorded event in Chrome trace format (times in microseconds)
+inline bool traceExport(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    TraceRegistry& registry = TraceRegistry::instance();
+    std::lock_guard<std::mutex> guard(registry.lock);
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (TraceBuffer* buffer : registry.buffers)
+    {
+        if (buffer->threadName)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", buffer->thread, buffer->threadName);
+            first = false;
+        }
+
+        uint64_t begin = buffer->count > TRACE_CAPACITY ? buffer->count - TRACE_CAPACITY : 0;
+        for (uint64_t i = begin; i < buffer->count; i++)
+        {
+            const TraceEvent& event = buffer->events[i % TRACE_CAPACITY];
+            if (event.phase == 'X')
+            {
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        first ? "" : ",\n", event.name, buffer->thread, event.time / 1000.0, event.value / 1000.0);
+            }
+            else
+            {
+                fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%llu}}",
+                        first ? "" : ",\n", event.name, buffer->thread, event.time / 1000.0,
+                        (unsigned long long)event.value);
+            }
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_COUNTER(name, value) traceCounter(name, (uint64_t)(value))
+#define TRACE_THREAD_NAME(name) traceThreadName(name)
+#define TRACE_EXPORT(path) traceExport(path)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_EXPORT(path) ((void)0)
+
+#endif
+
+#endif
@@ -1,297 +1,19 @@
 #include <iostream>
-#include <cmath>
 #include <termios.h>
 #include <unistd.h>
-#include <vector>
+#include <sys/ioctl.h>
 #include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+#include "render_thread.h"
+#include "walk_map.h"
+#include "dungeon.h"
+#include "trace.h"
 
 using namespace std;
-
-const int Width = 30;
-const int Height = 20;
-const double PI = 3.14159265359;
-const double FOV = 120.0; // Field of view in degrees
-
-// Forward declaration
-class Map;
-
-class Player
-{
-    public:
-        double x, y;
-        double angle; // Direction in degrees (0 = right, 90 = down, 180 = left, 270 = up)
-        
-        Player(double startX, double startY) : x(startX), y(startY), angle(0.0) {}
-        
-        void rotate(double deltaAngle)
-        {
-            angle += deltaAngle;
-            if (angle < 0) angle += 360;
-            if (angle >= 360) angle -= 360;
-        }
-        
-        void move(double distance, Map& gameMap);
-};
-
-class Map
-{
-    private:
-        char map[Height][Width];
-        bool visible[Height][Width];
-    public:
-        Map()
-        {
-            initizeMap();
-        }
-
-        void initizeMap()
-        {
-            for (int i = 0; i < Height; i++)
-            {
-                for (int j = 0; j < Width; j++)
-                {
-                    if(i == 0 || i == Height - 1 || j == 0 || j == Width - 1)
-                    {    map[i][j] = '#';}
-                    else
-                    {    map[i][j] = '.';}
-                }
-            }
-            
-            // Create a more interesting map with multiple structures
-            
-            // Central column (vertical wall)
-            for (int i = 7; i <= 12; i++)
-            {
-                map[i][15] = '#';
-            }
-            
-            // Left room walls
-            for (int j = 5; j <= 10; j++)
-            {
-                map[8][j] = '#';
-                map[12][j] = '#';
-            }
-            map[9][5] = '#';
-            map[10][5] = '#';
-            map[11][5] = '#';
-            
-            // Right room walls
-            for (int j = 20; j <= 25; j++)
-            {
-                map[8][j] = '#';
-                map[12][j] = '#';
-            }
-            map[9][25] = '#';
-            map[10][25] = '#';
-            map[11][25] = '#';
-            
-            // Scattered obstacles
-            map[4][7] = '#';
-            map[4][8] = '#';
-            map[15][7] = '#';
-            map[15][8] = '#';
-            
-            map[4][22] = '#';
-            map[4][23] = '#';
-            map[15][22] = '#';
-            map[15][23] = '#';
-            
-            // Small pillars
-            map[6][12] = '#';
-            map[6][18] = '#';
-            map[14][12] = '#';
-            map[14][18] = '#';
-        }
-        
-        bool isInFOV(double playerX, double playerY, double playerAngle, int targetX, int targetY)
-        {
-            double dx = targetX - playerX;
-            double dy = targetY - playerY;
-            // convertimos a grados
-            double angleToTarget = atan2(dy, dx) * 180.0 / PI;
-            // Normalize angles
-            if (angleToTarget < 0) angleToTarget += 360;
-            // calculate angle difference
-            double angleDiff = angleToTarget - playerAngle;
-            if (angleDiff < -180) angleDiff += 360;
-            if (angleDiff > 180) angleDiff -= 360;
-            // check if within FOV
-            return fabs(angleDiff) <= FOV / 2.0;
-        }
-        
-        bool hasLineOfSight(double x1, double y1, int x2, int y2)
-        {
-            // Bresenham's line algorithm with continuous start point
-            double dx = x2 - x1;
-            double dy = y2 - y1;
-            double distance = sqrt(dx * dx + dy * dy);
-            
-            if (distance < 0.01) return true;
-            
-            int steps = (int)(distance * 2) + 1;
-            double stepX = dx / steps;
-            double stepY = dy / steps;
-            
-            for (int i = 1; i < steps; i++)
-            {
-                double checkX = x1 + stepX * i;
-                double checkY = y1 + stepY * i;
-                int gridX = (int)round(checkX);
-                int gridY = (int)round(checkY);
-                
-                if (gridX >= 0 && gridX < Width && gridY >= 0 && gridY < Height)
-                {
-                    if (map[gridY][gridX] == '#')
-                    {
-                        return false;
-                    }
-                }
-            }
-            return true;
-        }
-        
-        void calculateVisibility(Player& player)
-        {
-            // Reset visibility
-            for (int i = 0; i < Height; i++)
-            {
-                for (int j = 0; j < Width; j++)
-                {
-                    visible[i][j] = false;
-                }
-            }
-            
-            // Check each cell
-            for (int i = 0; i < Height; i++)
-            {
-                for (int j = 0; j < Width; j++)
-                {
-                    if (isInFOV(player.x, player.y, player.angle, j, i))
-                    {
-                        if (hasLineOfSight(player.x, player.y, j, i))
-                        {
-                            visible[i][j] = true;
-                        }
-                    }
-                }
-            }
-        }
-
-        char getDirectionChar(double angle)
-        {
-            // Normalize angle to 0-360
-            while (angle < 0) angle += 360;
-            while (angle >= 360) angle -= 360;
-            
-            // Return character based on direction
-            if (angle >= 337.5 || angle < 22.5) return '>';      // Right
-            else if (angle >= 22.5 && angle < 67.5) return '\\';  // Down-Right
-            else if (angle >= 67.5 && angle < 112.5) return 'v';  // Down
-            else if (angle >= 112.5 && angle < 157.5) return '/'; // Down-Left
-            else if (angle >= 157.5 && angle < 202.5) return '<'; // Left
-            else if (angle >= 202.5 && angle < 247.5) return '/'; // Up-Left
-            else if (angle >= 247.5 && angle < 292.5) return '^'; // Up
-            else return '\\'; // Up-Right
-        }
-        
-        void displayMap(Player& player)
-        {
-            calculateVisibility(player);
-            
-            // Clear screen and move cursor to top
-            cout << "\033[2J\033[H";
-            
-            for (int i = 0; i < Height; i++)
-            {
-                for (int j = 0; j < Width; j++)
-                {
-                    int playerGridX = (int)round(player.x);
-                    int playerGridY = (int)round(player.y);
-                    
-                    if (j == playerGridX && i == playerGridY)
-                    {
-                        // Show player with direction indicator
-                        cout << getDirectionChar(player.angle);
-                    }
-                    else if (visible[i][j])
-                    {
-                        // Show visible tiles
-                        cout << map[i][j];
-                    }
-                    else if (map[i][j] == '#')
-                    {
-                        // Show walls/obstacles even if not directly visible (but dimmed)
-                        // Check if it's adjacent to visible area
-                        bool nearVisible = false;
-                        for (int di = -1; di <= 1 && !nearVisible; di++)
-                        {
-                            for (int dj = -1; dj <= 1 && !nearVisible; dj++)
-                            {
-                                int ni = i + di;
-                                int nj = j + dj;
-                                if (ni >= 0 && ni < Height && nj >= 0 && nj < Width)
-                                {
-                                    if (visible[ni][nj])
-                                    {
-                                        nearVisible = true;
-                                    }
-                                }
-                            }
-                        }
-                        
-                        if (nearVisible)
-                        {
-                            cout << '#'; // Show walls adjacent to visible areas
-                        }
-                        else
-                        {
-                            cout << ' '; // Hide far away walls
-                        }
-                    }
-                    else
-                    {
-                        cout << ' '; // Empty space for non-visible areas
-                    }
-                }
-                cout << endl;
-            }
-            
-            // Display info with direction indicator
-            cout << "\nPosition: (" << (int)round(player.x) << ", " << (int)round(player.y) << ")";
-            cout << " | Facing: " << (int)player.angle << " degrees " << getDirectionChar(player.angle);
-            cout << "\nControls: W/S=Forward/Back | A/D=Rotate | Q=Quit" << endl;
-            cout << "FOV: 120 degrees | Vision blocked by walls (#)" << endl;
-        }
-        
-        char getCell(int x, int y)
-        {
-            if (x >= 0 && x < Width && y >= 0 && y < Height)
-                return map[y][x];
-            return '#';
-        }
-};
-
-// Player move implementation (after Map class is defined)
-void Player::move(double distance, Map& gameMap)
-{
-    // Calculate new position based on angle
-    double radians = angle * PI / 180.0;
-    double newX = x + cos(radians) * distance;
-    double newY = y + sin(radians) * distance;
-    
-    // Check if new position is valid
-    int gridX = (int)round(newX);
-    int gridY = (int)round(newY);
-    
-    if (gridX >= 0 && gridX < Width && gridY >= 0 && gridY < Height)
-    {
-        if (gameMap.getCell(gridX, gridY) != '#')
-        {
-            x = newX;
-            y = newY;
-        }
-    }
-}
+using namespace walk;
 
 // Terminal input setup
 struct termios orig_termios;
@@ -314,6 +36,22 @@ void enableRawMode()
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
 }
 
+// terminal size in characters, 80x24 if it can't be read
+void terminalSize(int& columns, int& rows)
+{
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0)
+    {
+        columns = size.ws_col;
+        rows = size.ws_row;
+    }
+    else
+    {
+        columns = 80;
+        rows = 24;
+    }
+}
+
 char readKey()
 {
     char c = '\0';
@@ -321,15 +59,86 @@ char readKey()
     return c;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     Map gameMap;
     Player player(Width / 2.0, Height / 2.0);
+    vector<Light> torches;
+    
+    // walk -d [seed]: explore a dungeon generated like mapa2
+    if (argc > 1 && string(argv[1]) == "-d")
+    {
+        srand(argc > 2 ? (unsigned)atoi(argv[2]) : (unsigned)time(0));
+        dungeon::Map generated;
+        generated.generate();
+        gameMap = Map(generated.toRows());
+        
+        // start in the middle of the first room
+        if (!generated.getRooms().empty())
+        {
+            const dungeon::Room& room = generated.getRooms().front();
+            player = Player(room.centerX(), room.centerY());
+        }
+        
+        // torches in the middle of every room and on every door
+        for (const dungeon::Room& room : generated.getRooms()) torches.push_back(Light(room.centerX(), room.centerY(), 7, 220));
+        for (int y = 0; y < generated.height(); y++)
+        {
+            for (int x = 0; x < generated.width(); x++)
+            {
+                if (generated.getCell(x, y) == dungeon::Door) torches.push_back(Light(x, y, 4, 160));
+            }
+        }
+    }
+    
+    // the player carries a lantern, only its old and new area are relit
+    LightMap lights(gameMap.width(), gameMap.height(), [&](int x, int y) { return gameMap.getCell(x, y) == '#'; });
+    for (const Light& torch : torches) lights.addLight(torch);
+    int lantern = lights.addLight(Light((int)round(player.x), (int)round(player.y), 5, 180));
+    
+    // edited walls only relight the lights that reach them
+    gameMap.subscribe([&](const CellRect& changed)
+    {
+        lights.refresh(changed, [&](int x, int y) { return gameMap.getCell(x, y) == '#'; });
+    });
+    
+    // terminal output runs on its own thread
+    RenderThread<string> renderer([](const string& frame)
+    {
+        TRACE_SCOPE("present");
+        cout << frame << flush;
+        TRACE_COUNTER("bytes written", frame.size());
+    });
     
     enableRawMode();
+    renderer.start();
     
     bool running = true;
-    gameMap.displayMap(player);
+    bool firstPerson = false;
+    bool lighting = false;
+    
+    // builds the current view and hands it to the render thread
+    auto draw = [&]()
+    {
+        if (firstPerson)
+        {
+            int columns, rows;
+            terminalSize(columns, rows);
+            gameMap.displayFirstPerson(player, renderer.backBuffer(), columns, max(rows - 2, 1));
+        }
+        else
+        {
+            if (lighting)
+            {
+                lights.moveLight(lantern, (int)round(player.x), (int)round(player.y));
+                lights.update();
+            }
+            gameMap.displayMap(player, renderer.backBuffer(), lighting ? &lights : nullptr);
+        }
+        renderer.publish();
+    };
+    
+    draw();
     
     while (running)
     {
@@ -359,6 +168,30 @@ int main()
                 player.rotate(15.0);
                 needsRedraw = true;
                 break;
+            case 'v':
+            case 'V':
+                firstPerson = !firstPerson;
+                needsRedraw = true;
+                break;
+            case 'b':
+            case 'B':
+            {
+                // break the wall in front of the player
+                double radians = player.angle * PI / 180.0;
+                int x = (int)round(player.x + cos(radians));
+                int y = (int)round(player.y + sin(radians));
+                if (x > 0 && y > 0 && x < gameMap.width() - 1 && y < gameMap.height() - 1 && gameMap.getCell(x, y) == '#')
+                {
+                    gameMap.setCell(x, y, '.');
+                    needsRedraw = true;
+                }
+                break;
+            }
+            case 'l':
+            case 'L':
+                lighting = !lighting;
+                needsRedraw = true;
+                break;
             case 'q':
             case 'Q':
                 running = false;
@@ -367,14 +200,17 @@ int main()
         
         if (needsRedraw)
         {
-            gameMap.displayMap(player);
+            draw();
         }
         
         usleep(10000); // Small delay to prevent CPU spinning
     }
     
+    renderer.stop();
     cout << "\033[2J\033[H"; // Clear screen
     cout << "Game exited." << endl;
     
+    TRACE_EXPORT("walk_trace.json");
+    
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,724 @@
+#ifndef WALK_MAP_H
+#define WALK_MAP_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include "grid.h"
+#include "level_art.h"
+#include "lighting.h"
+#include "map_changes.h"
+#include "trace.h"
+
+// Map, player and views of walk.cpp, separate from the terminal code so the
+// benchmarks can use them
+namespace walk
+{
+
+// size of the built-in map
+const int Width = 30;
+const int Height = 20;
+// the built-in map, baked at compile time
+constexpr char builtInArt[] = R"(
+##############################
+#............................#
+#............................#
+#............................#
+#......##.............##.....#
+#............................#
+#...........#.....#..........#
+#..............#.............#
+#....######....#....######...#
+#....#.........#.........#...#
+#....#.........#.........#...#
+#....#.........#.........#...#
+#....######....#....######...#
+#............................#
+#...........#.....#..........#
+#......##.............##.....#
+#............................#
+#............................#
+#............................#
+##############################)";
+
+constexpr auto builtInLevel = bakeLevel<builtInArt, '#', '.'>();
+static_assert(builtInLevel.width == Width && builtInLevel.height == Height, "the built-in map must be Width x Height");
+
+const double PI = 3.14159265359;
+const double FOV = 120.0; // Field of view in degrees
+
+// Forward declaration
+class Map;
+
+// Ray directions for every screen column, relative to the facing direction.
+// Built once per terminal size: the first-person view casts one ray per column
+// and the top-down view tests its cone against the same FOV edge, so neither
+// calls atan2/sin/cos per cell or per column.
+struct RayTable
+{
+    int columns;
+    int rows;
+    std::vector<double> cosOffset; // cos of the column angle, also the fish-eye correction
+    std::vector<double> sinOffset; // sin of the column angle
+    std::vector<char> floorShade;  // floor character for every row of the first-person view
+    double cosHalfFOV;        // cos of the angle between the facing and the FOV edge
+
+    RayTable() : columns(0), rows(0), cosHalfFOV(std::cos(FOV / 2.0 * PI / 180.0)) {}
+
+    void build(int newColumns, int newRows)
+    {
+        if (newColumns == columns && newRows == rows) return;
+        columns = newColumns;
+        rows = newRows;
+
+        // columns are evenly spaced on the projection plane, not in angle
+        double halfPlane = std::tan(FOV / 2.0 * PI / 180.0);
+        cosOffset.resize(columns);
+        sinOffset.resize(columns);
+        for (int c = 0; c < columns; c++)
+        {
+            double offset = std::atan((2.0 * (c + 0.5) / columns - 1.0) * halfPlane);
+            cosOffset[c] = std::cos(offset);
+            sinOffset[c] = std::sin(offset);
+        }
+
+        // floor gets lighter towards the horizon
+        const char ramp[] = ":-. ";
+        floorShade.assign(rows, ' ');
+        for (int r = rows / 2; r < rows; r++)
+        {
+            double nearness = (r - rows / 2.0) / (rows / 2.0);
+            int shade = (int)((1.0 - nearness) * 4);
+            floorShade[r] = ramp[std::min(shade, 3)];
+        }
+    }
+};
+
+class Player
+{
+    public:
+        double x, y;
+        double angle; // Direction in degrees (0 = right, 90 = down, 180 = left, 270 = up)
+        
+        Player(double startX, double startY) : x(startX), y(startY), angle(0.0) {}
+        
+        void rotate(double deltaAngle)
+        {
+            angle += deltaAngle;
+            if (angle < 0) angle += 360;
+            if (angle >= 360) angle -= 360;
+        }
+        
+        void move(double distance, Map& gameMap);
+};
+
+class Map
+{
+    private:
+        // 8x8 tiles keep the FOV and dilation neighbourhoods in few cache lines
+        Grid<char, Tiled<8> > map;
+        Grid<bool, Tiled<8> > visible;
+        Grid<bool, Tiled<8> > explored;        // cells the player has ever seen
+        RayTable rays;
+
+        // viewpoint that visible was computed for
+        bool viewValid;
+        double viewX, viewY, viewAngle;
+        double viewFacingX, viewFacingY;       // unit vector of viewAngle
+
+        // Cells to test again, bucketed by twice their distance to the
+        // viewpoint along the longer axis. The cell a line of sight comes
+        // from is always at least one bucket nearer, so going through the
+        // buckets in order tests it first. calculateVisibility makes room
+        // for the farthest cell before anything is queued, so runQueue
+        // never grows it while going through it.
+        std::vector<std::vector<int> > queue;  // y << 16 | x
+        Grid<uint32_t, Tiled<8> > queuedAt;    // pass that last queued the cell
+        uint32_t pass;
+
+        // Cells whose 3x3 neighbourhood has cells that the view passes
+        // through and cells it doesn't. Only there can a step change which
+        // cell a line of sight comes from. The list may still hold cells
+        // that stopped being edges, the next step drops them.
+        std::vector<int> edges;                // y << 16 | x
+        Grid<bool, Tiled<8> > listedEdge;      // cell is in edges
+        
+        ChangeTracker changes;
+
+        // per-cell state that depends on the map size
+        void resetViews()
+        {
+            visible = Grid<bool, Tiled<8> >(map.width(), map.height(), false, false);
+            explored = Grid<bool, Tiled<8> >(map.width(), map.height(), false, false);
+            queuedAt = Grid<uint32_t, Tiled<8> >(map.width(), map.height(), 0, 0);
+            listedEdge = Grid<bool, Tiled<8> >(map.width(), map.height(), false, false);
+            queue.assign(2 * (std::max(map.width(), map.height()) + 2), std::vector<int>());
+            edges.clear();
+            pass = 0;
+            viewValid = false;
+            viewX = viewY = viewAngle = 0;
+        }
+
+        // next cell of a line of sight from (x, y) towards the viewpoint,
+        // false once it is next to the viewpoint
+        static bool lineStep(double viewX, double viewY, int& x, int& y)
+        {
+            double dx = viewX - x;
+            double dy = viewY - y;
+            double steps = std::max(std::fabs(dx), std::fabs(dy));
+            if (steps <= 1) return false;
+            x = (int)std::round(x + dx / steps);
+            y = (int)std::round(y + dy / steps);
+            return true;
+        }
+
+        // the view goes on past a seen cell that isn't a wall, and past the
+        // cells next to the viewpoint even when they are out of the cone
+        bool seenThrough(int x, int y) const
+        {
+            if (map.get(x, y) == '#') return false;
+            return visible.get(x, y) || std::max(std::fabs(x - viewX), std::fabs(y - viewY)) <= 1;
+        }
+
+        bool isEdge(int x, int y) const
+        {
+            bool through = seenThrough(x, y);
+            for (int ny = y - 1; ny <= y + 1; ny++)
+            {
+                for (int nx = x - 1; nx <= x + 1; nx++)
+                {
+                    if (map.inside(nx, ny) && seenThrough(nx, ny) != through) return true;
+                }
+            }
+            return false;
+        }
+
+        // the 3x3 neighbourhood of a cell that changed may have new edges
+        void listEdges(int x, int y)
+        {
+            for (int ny = y - 1; ny <= y + 1; ny++)
+            {
+                for (int nx = x - 1; nx <= x + 1; nx++)
+                {
+                    if (!map.inside(nx, ny) || listedEdge.at(nx, ny)) continue;
+                    listedEdge.at(nx, ny) = true;
+                    edges.push_back(ny << 16 | nx);
+                }
+            }
+        }
+
+        void newPass()
+        {
+            pass++;
+            if (pass >= 0xffffffff)
+            {
+                queuedAt.fill(0);
+                pass = 1;
+            }
+        }
+
+        void queueCell(int x, int y)
+        {
+            if (!map.inside(x, y) || queuedAt.at(x, y) == pass) return;
+            queuedAt.at(x, y) = pass;
+            size_t bucket = (size_t)(std::max(std::fabs(x - viewX), std::fabs(y - viewY)) * 2);
+            assert(bucket < queue.size());
+            queue[bucket].push_back(y << 16 | x);
+        }
+
+        // Tests the queued cells nearest first. A cell is seen when it is in
+        // the cone and the view goes on past the cell its line of sight
+        // comes from; the cells next to the viewpoint are seen when they
+        // are in the cone. When the view starts or stops passing through a
+        // cell, the cells whose lines come from it are queued too.
+        void runQueue()
+        {
+            int tested = 0;
+            for (std::vector<int>& bucket : queue)
+            {
+                for (size_t i = 0; i < bucket.size(); i++)
+                {
+                    int x = bucket[i] & 0xffff, y = bucket[i] >> 16;
+                    tested++;
+                    bool seen = isInFOV(viewX, viewY, viewFacingX, viewFacingY, x, y);
+                    int fromX = x, fromY = y;
+                    if (seen && lineStep(viewX, viewY, fromX, fromY)) seen = seenThrough(fromX, fromY);
+                    if (seen) explored.at(x, y) = true;
+                    if (seen == visible.at(x, y)) continue;
+                    
+                    visible.at(x, y) = seen;
+                    if (map.at(x, y) == '#') continue;
+                    listEdges(x, y);
+                    // lines come from a nearer cell, so only farther neighbours
+                    double steps = std::max(std::fabs(x - viewX), std::fabs(y - viewY));
+                    for (int ny = y - 1; ny <= y + 1; ny++)
+                    {
+                        for (int nx = x - 1; nx <= x + 1; nx++)
+                        {
+                            if (std::max(std::fabs(nx - viewX), std::fabs(ny - viewY)) <= steps) continue;
+                            fromX = nx;
+                            fromY = ny;
+                            if (lineStep(viewX, viewY, fromX, fromY) && fromX == x && fromY == y) queueCell(nx, ny);
+                        }
+                    }
+                }
+                bucket.clear();
+            }
+            TRACE_COUNTER("cells tested", tested);
+        }
+
+        // A changed cell can only alter the cells seen through it, which the
+        // queue reaches from its neighbours, so only those are tested again.
+        void invalidateVisibility(const CellRect& changed)
+        {
+            if (!viewValid) return;
+            newPass();
+            CellRect near = changed.grown(1);
+            for (int y = near.y0; y < near.y1; y++)
+            {
+                for (int x = near.x0; x < near.x1; x++)
+                {
+                    queueCell(x, y);
+                    if (map.inside(x, y)) listEdges(x, y);
+                }
+            }
+            runQueue();
+        }
+        
+        void applyChanges()
+        {
+            for (const CellRect& r : changes.take())
+            {
+                invalidateVisibility(r);
+                changes.notify(r);
+            }
+        }
+        
+        // Calls fn(x, y) for every cell that may lie in the wedge with apex
+        // (px, py) between the angles from and to (degrees, 0 < to - from < 180).
+        // Each row is clipped to the wedge edges and widened by one cell, so
+        // only cells near the wedge are visited and fn makes the exact test.
+        template <class Fn>
+        void forEachInWedge(double px, double py, double from, double to, Fn fn)
+        {
+            double ux = std::cos(from * PI / 180.0), uy = std::sin(from * PI / 180.0);
+            double vx = std::cos(to * PI / 180.0), vy = std::sin(to * PI / 180.0);
+            for (int y = 0; y < map.height(); y++)
+            {
+                // d = cell - apex is inside if cross(u, d) >= 0 and cross(d, v) >= 0
+                double dy = y - py;
+                double lo = -px, hi = map.width() - 1 - px;
+                if (std::fabs(uy) < 1e-9) { if (ux * dy < -1) continue; }
+                else if (uy > 0) hi = std::min(hi, ux * dy / uy);
+                else lo = std::max(lo, ux * dy / uy);
+                if (std::fabs(vy) < 1e-9) { if (-vx * dy < -1) continue; }
+                else if (vy > 0) lo = std::max(lo, vx * dy / vy);
+                else hi = std::min(hi, vx * dy / vy);
+
+                int x0 = std::max(0, (int)std::floor(px + lo) - 1);
+                int x1 = std::min(map.width() - 1, (int)std::ceil(px + hi) + 1);
+                for (int x = x0; x <= x1; x++) fn(x, y);
+            }
+        }
+    public:
+        // built-in map
+        Map()
+        {
+            initizeMap();
+        }
+        
+        // map from text rows, '#' is a wall; short rows are padded with walls
+        Map(const std::vector<std::string>& rows)
+        {
+            size_t widest = 0;
+            for (const std::string& row : rows) widest = std::max(widest, row.size());
+            
+            map = Grid<char, Tiled<8> >((int)widest, (int)rows.size(), '#', '#');
+            for (int i = 0; i < (int)rows.size(); i++)
+            {
+                for (int j = 0; j < (int)rows[i].size(); j++)
+                {
+                    map.at(j, i) = rows[i][j];
+                }
+            }
+            resetViews();
+        }
+        
+        int width() const { return map.width(); }
+        int height() const { return map.height(); }
+        
+        // Changes a cell during play. Outside a batch the caches and the
+        // listeners are updated right away, inside one when it ends.
+        void setCell(int x, int y, char value)
+        {
+            if (!map.inside(x, y) || map.at(x, y) == value) return;
+            map.at(x, y) = value;
+            changes.add(x, y);
+            if (!changes.batching()) applyChanges();
+        }
+        
+        void beginChanges() { changes.begin(); }
+        void endChanges() { if (changes.end()) applyChanges(); }
+        
+        // listener(rect) runs after every applied change
+        int subscribe(ChangeTracker::Listener listener) { return changes.subscribe(listener); }
+        void unsubscribe(int id) { changes.unsubscribe(id); }
+
+        void initizeMap()
+        {
+            map = Grid<char, Tiled<8> >(Width, Height, '.', '#');
+            resetViews();
+            builtInLevel.copyTo(map);
+        }
+        
+        // facingX/facingY is the unit vector of the player angle
+        bool isInFOV(double playerX, double playerY, double facingX, double facingY, int targetX, int targetY)
+        {
+            double dx = targetX - playerX;
+            double dy = targetY - playerY;
+            // angle to the target within FOV / 2 <=> cos(angle) >= cos(FOV / 2)
+            double dot = dx * facingX + dy * facingY;
+            return dot >= std::sqrt(dx * dx + dy * dy) * rays.cosHalfFOV;
+        }
+        
+        // Line of sight from (x1, y1) to the cell (x2, y2): walks from the
+        // cell towards the viewpoint, one cell along the longer axis per
+        // step, aiming again from every cell it lands on. So the line of a
+        // cell goes on with the line of the next one, which is how
+        // calculateVisibility builds the view a cell at a time. Cells next
+        // to the viewpoint are always seen.
+        bool hasLineOfSight(double x1, double y1, int x2, int y2)
+        {
+            int x = x2, y = y2;
+            while (lineStep(x1, y1, x, y))
+            {
+                if (map.inside(x, y) && map.at(x, y) == '#') return false;
+            }
+            return true;
+        }
+        
+        // Updates visible for the player's view. Only what can have changed
+        // since the last call is tested again: a rotation starts from the two
+        // wedges swept by the cone edges, a step of at most one cell from the
+        // edges of the old view, and from there only the cells seen through a
+        // cell that changed follow. So the cost of a step follows how much
+        // of the view changed, not the size of the cone. Seen cells are added
+        // to explored.
+        void calculateVisibility(Player& player)
+        {
+            TRACE_SCOPE("calculateVisibility");
+            
+            double delta = player.angle - viewAngle;
+            while (delta > 180) delta -= 360;
+            while (delta <= -180) delta += 360;
+            bool moved = player.x != viewX || player.y != viewY;
+            if (viewValid && !moved && delta == 0) return;
+            
+            bool wasValid = viewValid;
+            double fromX = viewX, fromY = viewY, fromAngle = viewAngle;
+            viewValid = true;
+            viewX = player.x;
+            viewY = player.y;
+            viewAngle = player.angle;
+            // Facing direction, computed once instead of per cell
+            double radians = player.angle * PI / 180.0;
+            viewFacingX = std::cos(radians);
+            viewFacingY = std::sin(radians);
+            
+            // a bucket for every distance from the viewpoint to a cell of the
+            // map, even when the viewpoint is outside it
+            double farthest = std::max(std::max(viewX, map.width() - 1 - viewX), std::max(viewY, map.height() - 1 - viewY));
+            if (queue.size() <= (size_t)(farthest * 2)) queue.resize((size_t)(farthest * 2) + 1);
+            
+            newPass();
+            auto seed = [&](int x, int y) { queueCell(x, y); };
+            if (wasValid && !moved && std::fabs(delta) < 170)
+            {
+                // cells that entered or left the cone lie between the old
+                // and the new position of each edge
+                double from = std::min(fromAngle, fromAngle + delta);
+                double to = std::max(fromAngle, fromAngle + delta);
+                forEachInWedge(viewX, viewY, from - FOV / 2.0, to - FOV / 2.0, seed);
+                forEachInWedge(viewX, viewY, from + FOV / 2.0, to + FOV / 2.0, seed);
+            }
+            else if (wasValid && delta == 0 && std::fabs(viewX - fromX) <= 1 && std::fabs(viewY - fromY) <= 1)
+            {
+                // The cone moved by at most a cell and a line of sight can only
+                // come from another cell where the view edges are. Near
+                // both viewpoints lines start and end.
+                size_t kept = 0;
+                for (int cell : edges)
+                {
+                    int x = cell & 0xffff, y = cell >> 16;
+                    if (!isEdge(x, y))
+                    {
+                        listedEdge.at(x, y) = false;
+                        continue;
+                    }
+                    edges[kept++] = cell;
+                    queueCell(x, y);
+                }
+                edges.resize(kept);
+                for (int y = -3; y <= 3; y++)
+                {
+                    for (int x = -3; x <= 3; x++)
+                    {
+                        queueCell((int)std::round(fromX) + x, (int)std::round(fromY) + y);
+                        queueCell((int)std::round(viewX) + x, (int)std::round(viewY) + y);
+                    }
+                }
+            }
+            else
+            {
+                // anything in the old or the new cone
+                if (wasValid) forEachInWedge(fromX, fromY, fromAngle - FOV / 2.0, fromAngle + FOV / 2.0, seed);
+                forEachInWedge(viewX, viewY, viewAngle - FOV / 2.0, viewAngle + FOV / 2.0, seed);
+            }
+            runQueue();
+        }
+
+        bool isExplored(int x, int y) const
+        {
+            return explored.get(x, y);
+        }
+
+        // result of the last calculateVisibility
+        bool isVisible(int x, int y) const
+        {
+            return visible.get(x, y);
+        }
+
+        char getDirectionChar(double angle)
+        {
+            // Normalize angle to 0-360
+            while (angle < 0) angle += 360;
+            while (angle >= 360) angle -= 360;
+            
+            // Return character based on direction
+            if (angle >= 337.5 || angle < 22.5) return '>';      // Right
+            else if (angle >= 22.5 && angle < 67.5) return '\\';  // Down-Right
+            else if (angle >= 67.5 && angle < 112.5) return 'v';  // Down
+            else if (angle >= 112.5 && angle < 157.5) return '/'; // Down-Left
+            else if (angle >= 157.5 && angle < 202.5) return '<'; // Left
+            else if (angle >= 202.5 && angle < 247.5) return '/'; // Up-Left
+            else if (angle >= 247.5 && angle < 292.5) return '^'; // Up
+            else return '\\'; // Up-Right
+        }
+        
+        // Builds the whole screen into frame, the render thread writes it.
+        // With lighting, visible floor is drawn by its light level and dark
+        // floor can't be seen.
+        void displayMap(Player& player, std::string& frame, const LightMap* lighting = nullptr)
+        {
+            TRACE_SCOPE("displayMap");
+            calculateVisibility(player);
+            
+            // Clear screen and move cursor to top
+            frame = "\033[2J\033[H";
+            
+            // remembered cells are drawn dim, escapes only where it changes
+            bool dim = false;
+            
+            for (int i = 0; i < map.height(); i++)
+            {
+                for (int j = 0; j < map.width(); j++)
+                {
+                    int playerGridX = (int)std::round(player.x);
+                    int playerGridY = (int)std::round(player.y);
+                    
+                    char cell = ' '; // Empty space for non-visible areas
+                    bool remembered = false;
+                    if (j == playerGridX && i == playerGridY)
+                    {
+                        // Show player with direction indicator
+                        cell = getDirectionChar(player.angle);
+                    }
+                    else if (visible.at(j, i))
+                    {
+                        // Show visible tiles
+                        cell = map.at(j, i);
+                        if (lighting && (cell == '.' || cell == ' '))
+                        {
+                            const char ramp[] = " .:-=";
+                            cell = ramp[lighting->level(j, i) * 5 / 256];
+                        }
+                    }
+                    else
+                    {
+                        // Show walls/obstacles even if not directly visible
+                        // if they are adjacent to the visible area (the border is never visible)
+                        bool nearVisible = false;
+                        if (map.at(j, i) == '#')
+                        {
+                            for (int di = -1; di <= 1 && !nearVisible; di++)
+                            {
+                                for (int dj = -1; dj <= 1 && !nearVisible; dj++)
+                                {
+                                    if (visible.at(j + dj, i + di))
+                                    {
+                                        nearVisible = true;
+                                    }
+                                }
+                            }
+                        }
+                        
+                        if (nearVisible)
+                        {
+                            cell = '#';
+                            explored.at(j, i) = true; // seen walls are remembered too
+                        }
+                        else if (explored.at(j, i))
+                        {
+                            // seen before, drawn dimmed
+                            cell = map.at(j, i);
+                            remembered = true;
+                        }
+                    }
+                    
+                    if (remembered != dim)
+                    {
+                        frame += remembered ? "\033[2m" : "\033[22m";
+                        dim = remembered;
+                    }
+                    frame += cell;
+                }
+                frame += '\n';
+            }
+            if (dim) frame += "\033[22m";
+            
+            // Display info with direction indicator
+            frame += "\nPosition: (" + std::to_string((int)std::round(player.x)) + ", " + std::to_string((int)std::round(player.y)) + ")";
+            frame += " | Facing: " + std::to_string((int)player.angle) + " degrees " + getDirectionChar(player.angle);
+            frame += "\nControls: W/S=Forward/Back | A/D=Rotate | V=First person | L=Light | B=Break wall | Q=Quit\n";
+            frame += "FOV: 120 degrees | Vision blocked by walls (#)\n";
+        }
+        
+        // Grid DDA from (x, y) along the unit vector (dirX, dirY), returns the
+        // distance to the first wall and which kind of cell edge was hit
+        double castRay(double x, double y, double dirX, double dirY, int& side)
+        {
+            // cells are centered on integer coordinates
+            double posX = x + 0.5;
+            double posY = y + 0.5;
+            int cellX = (int)std::floor(posX);
+            int cellY = (int)std::floor(posY);
+            
+            // distance along the ray between two vertical / horizontal cell edges
+            double deltaX = dirX == 0 ? 1e30 : std::fabs(1.0 / dirX);
+            double deltaY = dirY == 0 ? 1e30 : std::fabs(1.0 / dirY);
+            
+            int stepX, stepY;
+            double sideDistX, sideDistY;
+            if (dirX < 0) { stepX = -1; sideDistX = (posX - cellX) * deltaX; }
+            else          { stepX = 1;  sideDistX = (cellX + 1.0 - posX) * deltaX; }
+            if (dirY < 0) { stepY = -1; sideDistY = (posY - cellY) * deltaY; }
+            else          { stepY = 1;  sideDistY = (cellY + 1.0 - posY) * deltaY; }
+            
+            // outside the map counts as wall, so the walk always ends
+            do
+            {
+                if (sideDistX < sideDistY)
+                {
+                    sideDistX += deltaX;
+                    cellX += stepX;
+                    side = 0;
+                }
+                else
+                {
+                    sideDistY += deltaY;
+                    cellY += stepY;
+                    side = 1;
+                }
+            }
+            while (getCell(cellX, cellY) != '#');
+            return side == 0 ? sideDistX - deltaX : sideDistY - deltaY;
+        }
+        
+        // Pseudo-3D view: one ray per terminal column, wall slices shaded by distance
+        void displayFirstPerson(Player& player, std::string& frame, int columns, int rows)
+        {
+            TRACE_SCOPE("displayFirstPerson");
+            rays.build(columns, rows);
+            
+            double radians = player.angle * PI / 180.0;
+            double facingX = std::cos(radians);
+            double facingY = std::sin(radians);
+            
+            // Move cursor to top, every cell of the view is overwritten
+            frame = "\033[H";
+            size_t origin = frame.size();
+            size_t stride = columns + 1;
+            frame.append(rows * stride, ' ');
+            for (int r = 0; r < rows; r++) frame[origin + r * stride + columns] = '\n';
+            
+            // near walls are dense, far walls are light
+            const char ramp[] = "@#%*+=";
+            const int shades = 6;
+            const double maxDepth = std::min(std::max(map.width(), map.height()) * 0.75, 24.0);
+            
+            for (int c = 0; c < columns; c++)
+            {
+                // column direction = facing rotated by the column angle
+                double dirX = facingX * rays.cosOffset[c] - facingY * rays.sinOffset[c];
+                double dirY = facingY * rays.cosOffset[c] + facingX * rays.sinOffset[c];
+                
+                int side;
+                double distance = castRay(player.x, player.y, dirX, dirY, side);
+                
+                // distance to the camera plane avoids the fish-eye effect
+                double perpendicular = std::max(distance * rays.cosOffset[c], 0.05);
+                int wallHeight = (int)(rows / perpendicular);
+                int top = std::max(0, (rows - wallHeight) / 2);
+                int bottom = std::min(rows, (rows + wallHeight) / 2 + 1);
+                
+                // faces along y are one shade darker
+                int shade = std::min(shades - 1, (int)(perpendicular / maxDepth * shades) + side);
+                char wall = ramp[shade];
+                
+                char* cell = &frame[origin + c];
+                for (int r = 0; r < rows; r++, cell += stride)
+                {
+                    if (r < top) *cell = ' ';
+                    else if (r < bottom) *cell = wall;
+                    else *cell = rays.floorShade[r];
+                }
+            }
+            TRACE_COUNTER("rays cast", columns);
+            
+            frame += "Position: (" + std::to_string((int)std::round(player.x)) + ", " + std::to_string((int)std::round(player.y)) + ")";
+            frame += " | Facing: " + std::to_string((int)player.angle) + " degrees " + getDirectionChar(player.angle) + "\033[K\n";
+            frame += "Controls: W/S=Forward/Back | A/D=Rotate | V=Top-down map | Q=Quit\033[K";
+        }
+        
+        char getCell(int x, int y)
+        {
+            return map.get(x, y);
+        }
+};
+
+// Player move implementation (after Map class is defined)
+inline void Player::move(double distance, Map& gameMap)
+{
+    // Calculate new position based on angle
+    double radians = angle * PI / 180.0;
+    double newX = x + std::cos(radians) * distance;
+    double newY = y + std::sin(radians) * distance;
+    
+    // Check if new position is valid
+    int gridX = (int)std::round(newX);
+    int gridY = (int)std::round(newY);
+    
+    // cells outside the map read as walls
+    if (gameMap.getCell(gridX, gridY) != '#')
+    {
+        x = newX;
+        y = newY;
+    }
+}
+
+} // namespace walk
+
+#endif